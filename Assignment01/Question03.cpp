@@ -100,6 +100,241 @@ bool isValid(int x, int y)
     return x >= 0 && x < 3 && y >= 0 && y < 3;
 }
 
+// Number of inversions among the tiles (empty cell ignored) in row-major order
+int countInversions(const vector<vector<int>> &board)
+{
+    vector<int> tiles;
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            if (board[i][j] != 0)
+                tiles.push_back(board[i][j]);
+
+    int inversions = 0;
+    for (size_t i = 0; i < tiles.size(); i++)
+        for (size_t j = i + 1; j < tiles.size(); j++)
+            if (tiles[i] > tiles[j])
+                inversions++;
+    return inversions;
+}
+
+/*
+    On a board of odd width a move never changes the parity of the tile inversions,
+    so the goal is reachable only if both boards have the same inversion parity.
+*/
+bool isSolvable(const vector<vector<int>> &initial, const vector<vector<int>> &goal)
+{
+    return countInversions(initial) % 2 == countInversions(goal) % 2;
+}
+
+/*
+    Distance oracle for a fixed goal.
+
+    A reachable board is identified by the position of the empty cell and the order
+    of the 8 tiles read row-wise. The tile order is ranked by its Lehmer code; the
+    ranks 2k and 2k+1 differ by a swap of the last two tiles and therefore have
+    opposite parity, so (rank >> 1) is unique among the boards of the goal's parity.
+    This gives a dense index over exactly 9 * 8!/2 = 9!/2 states, and one byte of
+    distance per state (the 8-puzzle diameter is 31).
+
+    The table is filled once by a backward BFS from the goal (moves are reversible)
+    and can be saved to disk; afterwards an optimal solution is a walk that always
+    steps to a neighbour one move closer to the goal.
+*/
+class PuzzleOracle
+{
+public:
+    static constexpr int TILE_PERMUTATIONS = 40320; // 8!
+    static constexpr int STATES = 9 * TILE_PERMUTATIONS / 2;
+
+private:
+    static constexpr uint8_t UNREACHED = 0xFF;
+
+    vector<vector<int>> goal;
+    int goalParity;
+    vector<uint8_t> dist;
+
+    // Lehmer-code rank of the tile order of a row-major board (empty cell skipped)
+    static int rankTiles(const array<int, 9> &cells, int &emptyPos)
+    {
+        int tiles[8], n = 0;
+        for (int i = 0; i < 9; i++)
+        {
+            if (cells[i] == 0)
+                emptyPos = i;
+            else
+                tiles[n++] = cells[i];
+        }
+
+        static const int factorial[8] = {5040, 720, 120, 24, 6, 2, 1, 1};
+        int rank = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            int smaller = 0;
+            for (int j = i + 1; j < 8; j++)
+                if (tiles[j] < tiles[i])
+                    smaller++;
+            rank += smaller * factorial[i];
+        }
+        return rank;
+    }
+
+    static array<int, 9> flatten(const vector<vector<int>> &board)
+    {
+        array<int, 9> cells;
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                cells[i * 3 + j] = board[i][j];
+        return cells;
+    }
+
+    static vector<vector<int>> unflatten(const array<int, 9> &cells)
+    {
+        vector<vector<int>> board(3, vector<int>(3));
+        for (int i = 0; i < 9; i++)
+            board[i / 3][i % 3] = cells[i];
+        return board;
+    }
+
+    // Neighbouring boards of a row-major board, written into next; returns their count
+    static int neighbours(const array<int, 9> &cells, array<int, 9> next[4])
+    {
+        int dx[] = {-1, 0, 1, 0};
+        int dy[] = {0, 1, 0, -1};
+
+        int emptyPos = find(cells.begin(), cells.end(), 0) - cells.begin();
+        int x = emptyPos / 3, y = emptyPos % 3;
+        int count = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            int newX = x + dx[i];
+            int newY = y + dy[i];
+            if (isValid(newX, newY))
+            {
+                next[count] = cells;
+                swap(next[count][emptyPos], next[count][newX * 3 + newY]);
+                count++;
+            }
+        }
+        return count;
+    }
+
+public:
+    // Dense index in [0, STATES) of a row-major board, unique among boards of one parity
+    static int indexOf(const array<int, 9> &cells)
+    {
+        int emptyPos = 0;
+        int rank = rankTiles(cells, emptyPos);
+        return emptyPos * (TILE_PERMUTATIONS / 2) + (rank >> 1);
+    }
+
+    PuzzleOracle(const vector<vector<int>> &goal)
+        : goal(goal), goalParity(countInversions(goal) % 2) {}
+
+    // Backward BFS from the goal over all 9!/2 reachable boards
+    void build()
+    {
+        dist.assign(STATES, UNREACHED);
+        vector<array<int, 9>> queue;
+        queue.reserve(STATES);
+
+        array<int, 9> start = flatten(goal);
+        dist[indexOf(start)] = 0;
+        queue.push_back(start);
+
+        array<int, 9> next[4];
+        for (size_t head = 0; head < queue.size(); head++)
+        {
+            uint8_t d = dist[indexOf(queue[head])];
+            int count = neighbours(queue[head], next);
+            for (int i = 0; i < count; i++)
+            {
+                int idx = indexOf(next[i]);
+                if (dist[idx] == UNREACHED)
+                {
+                    dist[idx] = d + 1;
+                    queue.push_back(next[i]);
+                }
+            }
+        }
+    }
+
+    // File layout: 9 goal cells followed by one distance byte per state
+    bool save(const string &path) const
+    {
+        ofstream out(path, ios::binary);
+        if (!out)
+            return false;
+        array<int, 9> cells = flatten(goal);
+        for (int c : cells)
+            out.put((char)c);
+        out.write((const char *)dist.data(), dist.size());
+        return (bool)out;
+    }
+
+    // Loads a table saved for the same goal; returns false if it is missing or stale
+    bool load(const string &path)
+    {
+        ifstream in(path, ios::binary);
+        if (!in)
+            return false;
+        array<int, 9> cells = flatten(goal);
+        for (int c : cells)
+            if (in.get() != c)
+                return false;
+        dist.assign(STATES, UNREACHED);
+        in.read((char *)dist.data(), dist.size());
+        return in.gcount() == STATES;
+    }
+
+    // Loads the table from path if possible, otherwise builds and saves it
+    void loadOrBuild(const string &path)
+    {
+        if (!load(path))
+        {
+            build();
+            save(path);
+        }
+    }
+
+    // Number of moves to the goal, or -1 if the goal cannot be reached
+    int distance(const vector<vector<int>> &board) const
+    {
+        if (countInversions(board) % 2 != goalParity)
+            return -1;
+        return dist[indexOf(flatten(board))];
+    }
+
+    // Optimal solution as the sequence of boards after each move (same shape as solvePuzzle)
+    vector<State *> solve(const vector<vector<int>> &initial) const
+    {
+        vector<State *> path;
+        int d = distance(initial);
+        if (d < 0)
+            return path;
+
+        array<int, 9> cells = flatten(initial);
+        array<int, 9> next[4];
+        while (d > 0)
+        {
+            int count = neighbours(cells, next);
+            for (int i = 0; i < count; i++)
+            {
+                if (dist[indexOf(next[i])] == d - 1)
+                {
+                    cells = next[i];
+                    break;
+                }
+            }
+            d--;
+
+            State *state = new State(unflatten(cells));
+            state->g = path.size() + 1;
+            path.push_back(state);
+        }
+        return path;
+    }
+};
+
 // Solve 8-puzzle using A* search algorithm
 vector<State *> solvePuzzle(const vector<vector<int>> &initial, const vector<vector<int>> &goal, bool useManhattan)
 {
@@ -107,6 +342,12 @@ vector<State *> solvePuzzle(const vector<vector<int>> &initial, const vector<vec
     int dx[] = {-1, 0, 1, 0};
     int dy[] = {0, 1, 0, -1};
 
+    // Half of all boards can never reach the goal; reject them without searching
+    if (!isSolvable(initial, goal))
+    {
+        return vector<State *>();
+    }
+
     priority_queue<State> pq;
     set<string> visited;
 
@@ -159,6 +400,236 @@ vector<State *> solvePuzzle(const vector<vector<int>> &initial, const vector<vec
     return vector<State *>(); // No solution found
 }
 
+/*
+    Batch solving.
+
+    A batch holds many (initial, goal) pairs, so the per-instance cost matters more
+    than anything printed. Each worker thread owns one BatchSearcher whose tables are
+    indexed by PuzzleOracle::indexOf and allocated once; a generation counter marks
+    which entries belong to the current instance, so nothing is cleared between
+    instances. Boards are packed into 4 bits per cell, and the open list is a bucket
+    queue over f (the Manhattan distance is consistent, so f never decreases along a
+    path and every board is expanded at most once).
+*/
+struct BatchResult
+{
+    string moves;      // moves of the empty cell (U, R, D, L)
+    int length;        // number of moves, -1 if the goal cannot be reached
+    long long expanded; // boards expanded by the search
+};
+
+class BatchSearcher
+{
+private:
+    static constexpr int MAX_F = 64;
+
+    vector<uint32_t> stamp;  // generation in which the entry was last written
+    vector<uint8_t> bestG;   // best known g
+    vector<uint8_t> moveIn;  // move that reached the board with bestG; bit 7 marks it closed
+    uint32_t generation = 0;
+    vector<vector<uint64_t>> buckets;
+
+    static array<int, 9> cellsOf(uint64_t packed)
+    {
+        array<int, 9> cells;
+        for (int i = 0; i < 9; i++)
+            cells[i] = (packed >> (4 * i)) & 0xF;
+        return cells;
+    }
+
+public:
+    BatchSearcher()
+        : stamp(PuzzleOracle::STATES, 0), bestG(PuzzleOracle::STATES), moveIn(PuzzleOracle::STATES), buckets(MAX_F) {}
+
+    static uint64_t pack(const vector<vector<int>> &board)
+    {
+        uint64_t packed = 0;
+        for (int i = 0; i < 9; i++)
+            packed |= (uint64_t)board[i / 3][i % 3] << (4 * i);
+        return packed;
+    }
+
+    BatchResult solve(uint64_t initial, uint64_t goal)
+    {
+        // Possible moves (up, right, down, left)
+        static const int dx[] = {-1, 0, 1, 0};
+        static const int dy[] = {0, 1, 0, -1};
+        static const char names[] = "URDL";
+
+        BatchResult result{"", -1, 0};
+        array<int, 9> start = cellsOf(initial), target = cellsOf(goal);
+        vector<vector<int>> a(3, vector<int>(3)), b(3, vector<int>(3));
+        for (int i = 0; i < 9; i++)
+        {
+            a[i / 3][i % 3] = start[i];
+            b[i / 3][i % 3] = target[i];
+        }
+        if (!isSolvable(a, b))
+            return result;
+
+        int goalPos[9];
+        for (int i = 0; i < 9; i++)
+            goalPos[target[i]] = i;
+        auto tileDistance = [&](int tile, int pos)
+        {
+            return abs(pos / 3 - goalPos[tile] / 3) + abs(pos % 3 - goalPos[tile] % 3);
+        };
+
+        if (++generation == 0)
+        {
+            fill(stamp.begin(), stamp.end(), 0);
+            generation = 1;
+        }
+        for (auto &bucket : buckets)
+            bucket.clear();
+
+        int h = 0;
+        for (int i = 0; i < 9; i++)
+            if (start[i] != 0)
+                h += tileDistance(start[i], i);
+
+        int startIndex = PuzzleOracle::indexOf(start);
+        stamp[startIndex] = generation;
+        bestG[startIndex] = 0;
+        moveIn[startIndex] = 4;
+        buckets[h].push_back(initial);
+
+        for (int f = h; f < MAX_F; f++)
+        {
+            while (!buckets[f].empty())
+            {
+                uint64_t board = buckets[f].back();
+                buckets[f].pop_back();
+                int index = PuzzleOracle::indexOf(cellsOf(board));
+                if (moveIn[index] & 0x80)
+                    continue; // already expanded through a cheaper entry
+                moveIn[index] |= 0x80;
+                int g = bestG[index];
+
+                if (board == goal)
+                {
+                    // Walk the stored moves back to the initial board
+                    for (int move = moveIn[index] & 0x7F; move != 4; move = moveIn[index] & 0x7F)
+                    {
+                        result.moves += names[move];
+                        int emptyPos = 0;
+                        while ((board >> (4 * emptyPos)) & 0xF)
+                            emptyPos++;
+                        int from = (emptyPos / 3 - dx[move]) * 3 + emptyPos % 3 - dy[move];
+                        uint64_t tile = (board >> (4 * from)) & 0xF;
+                        board = board - (tile << (4 * from)) + (tile << (4 * emptyPos));
+                        index = PuzzleOracle::indexOf(cellsOf(board));
+                    }
+                    reverse(result.moves.begin(), result.moves.end());
+                    result.length = g;
+                    return result;
+                }
+
+                result.expanded++;
+                int emptyPos = 0;
+                while ((board >> (4 * emptyPos)) & 0xF)
+                    emptyPos++;
+                int boardH = f - g;
+                for (int i = 0; i < 4; i++)
+                {
+                    int newX = emptyPos / 3 + dx[i];
+                    int newY = emptyPos % 3 + dy[i];
+                    if (!isValid(newX, newY))
+                        continue;
+                    int tilePos = newX * 3 + newY;
+                    uint64_t tile = (board >> (4 * tilePos)) & 0xF;
+                    uint64_t next = board - (tile << (4 * tilePos)) + (tile << (4 * emptyPos));
+
+                    int nextIndex = PuzzleOracle::indexOf(cellsOf(next));
+                    if (stamp[nextIndex] == generation && bestG[nextIndex] <= g + 1)
+                        continue;
+                    stamp[nextIndex] = generation;
+                    bestG[nextIndex] = g + 1;
+                    moveIn[nextIndex] = i;
+
+                    int nextH = boardH - tileDistance(tile, tilePos) + tileDistance(tile, emptyPos);
+                    buckets[g + 1 + nextH].push_back(next);
+                }
+            }
+        }
+        return result;
+    }
+};
+
+// Parses a board written as 9 digits (boardToString format); false if it is not a permutation of 0-8
+bool parseBoard(const string &text, uint64_t &packed)
+{
+    if (text.size() != 9)
+        return false;
+    int seen = 0;
+    packed = 0;
+    for (int i = 0; i < 9; i++)
+    {
+        int value = text[i] - '0';
+        if (value < 0 || value > 8 || (seen >> value) & 1)
+            return false;
+        seen |= 1 << value;
+        packed |= (uint64_t)value << (4 * i);
+    }
+    return true;
+}
+
+/*
+    Reads "initial goal" pairs (two 9-digit boards per line) and writes one line per
+    instance in input order: the moves of the empty cell ("-" when there are none),
+    the solution length (-1 if unsolvable or malformed) and the boards expanded.
+    Instances are handed out in chunks to a pool of threads with one BatchSearcher each.
+*/
+void solveBatch(istream &in, ostream &out, int nThreads)
+{
+    vector<pair<uint64_t, uint64_t>> instances;
+    vector<bool> malformed;
+    string initialText, goalText;
+    while (in >> initialText >> goalText)
+    {
+        uint64_t initial = 0, goal = 0;
+        bool ok = parseBoard(initialText, initial) && parseBoard(goalText, goal);
+        instances.push_back({initial, goal});
+        malformed.push_back(!ok);
+    }
+
+    const size_t CHUNK = 1024;
+    size_t nChunks = (instances.size() + CHUNK - 1) / CHUNK;
+    vector<string> output(nChunks);
+    atomic<size_t> nextChunk{0};
+
+    auto begin = chrono::steady_clock::now();
+    auto worker = [&]()
+    {
+        BatchSearcher searcher;
+        for (size_t chunk = nextChunk++; chunk < nChunks; chunk = nextChunk++)
+        {
+            string &text = output[chunk];
+            for (size_t i = chunk * CHUNK; i < min(instances.size(), (chunk + 1) * CHUNK); i++)
+            {
+                BatchResult result{"", -1, 0};
+                if (!malformed[i])
+                    result = searcher.solve(instances[i].first, instances[i].second);
+                text += result.moves.empty() ? "-" : result.moves;
+                text += " " + to_string(result.length) + " " + to_string(result.expanded) + "\n";
+            }
+        }
+    };
+
+    vector<thread> threads;
+    for (int i = 0; i < nThreads; i++)
+        threads.emplace_back(worker);
+    for (thread &t : threads)
+        t.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    for (const string &text : output)
+        out << text;
+    out.flush();
+    cerr << "Solved " << instances.size() << " instances in " << fixed << setprecision(3) << seconds << " s ("
+         << (seconds > 0 ? instances.size() / seconds : 0.0) << " instances/s) using " << nThreads << " threads\n";
+}
+
 // Print board state
 void printBoard(const vector<vector<int>> &board)
 {
@@ -183,7 +654,50 @@ int main(int argc, char *argv[])
     vector<vector<int>> initial(3, vector<int>(3, 0));
     vector<vector<int>> goal(3, vector<int>(3, 0));
 
-    if (argc > 1)
+    /*
+        --oracle            answer from the precomputed distance table
+        --batch <file|->    solve "initial goal" pairs from a file or stdin
+        --threads <k>       worker threads for --batch
+        any other argument reads the boards interactively
+    */
+    bool interactive = false;
+    bool useOracle = false;
+    string batchFile;
+    int nThreads = max(1u, thread::hardware_concurrency());
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--oracle")
+            useOracle = true;
+        else if (arg == "--batch" && i + 1 < argc)
+            batchFile = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc)
+            nThreads = max(1, atoi(argv[++i]));
+        else
+            interactive = true;
+    }
+
+    if (!batchFile.empty())
+    {
+        ios::sync_with_stdio(false);
+        if (batchFile == "-")
+        {
+            solveBatch(cin, cout, nThreads);
+        }
+        else
+        {
+            ifstream in(batchFile);
+            if (!in)
+            {
+                cerr << "Cannot open " << batchFile << "\n";
+                return 1;
+            }
+            solveBatch(in, cout, nThreads);
+        }
+        return 0;
+    }
+
+    if (interactive)
     {
         cout << "Enter the values of cells in initial matrix\n";
         for (int i = 0; i < 3; i++)
@@ -221,6 +735,28 @@ int main(int argc, char *argv[])
     cout << "Goal State:\n";
     printBoard(goal);
 
+    if (!isSolvable(initial, goal))
+    {
+        cout << "The goal state cannot be reached from the initial state\n";
+        return 0;
+    }
+
+    if (useOracle)
+    {
+        string tableFile = "oracle_" + boardToString(goal) + ".bin";
+        PuzzleOracle oracle(goal);
+        oracle.loadOrBuild(tableFile);
+
+        cout << "Solving using the distance oracle (" << tableFile << ")...\n";
+        vector<State *> solution = oracle.solve(initial);
+        cout << "Solution found in " << solution.size() << " moves!\n";
+        for (State *state : solution)
+        {
+            printBoard(state->board);
+        }
+        return 0;
+    }
+
     cout << "Solving using Misplaced Tiles heuristic...\n";
     vector<State *> solution1 = solvePuzzle(initial, goal, false);
     if (!solution1.empty())
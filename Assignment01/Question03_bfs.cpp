@@ -100,6 +100,72 @@ bool isValid(int x, int y)
     return x >= 0 && x < 3 && y >= 0 && y < 3;
 }
 
+// Number of inversions among the tiles (empty cell ignored) in row-major order
+int countInversions(const vector<vector<int>> &board)
+{
+    vector<int> tiles;
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            if (board[i][j] != 0)
+                tiles.push_back(board[i][j]);
+
+    int inversions = 0;
+    for (size_t i = 0; i < tiles.size(); i++)
+        for (size_t j = i + 1; j < tiles.size(); j++)
+            if (tiles[i] > tiles[j])
+                inversions++;
+    return inversions;
+}
+
+// Moves keep the inversion parity on a 3x3 board, so it must match the goal's
+bool isSolvable(const vector<vector<int>> &initial, const vector<vector<int>> &goal)
+{
+    return countInversions(initial) % 2 == countInversions(goal) % 2;
+}
+
+// Board packed into 4 bits per cell, row-major, cell (0,0) in the lowest nibble
+uint64_t packBoard(const vector<vector<int>> &board)
+{
+    uint64_t packed = 0;
+    for (int i = 0; i < 9; i++)
+        packed |= (uint64_t)board[i / 3][i % 3] << (4 * i);
+    return packed;
+}
+
+vector<vector<int>> unpackBoard(uint64_t packed)
+{
+    vector<vector<int>> board(3, vector<int>(3));
+    for (int i = 0; i < 9; i++)
+        board[i / 3][i % 3] = (packed >> (4 * i)) & 0xF;
+    return board;
+}
+
+// Packed boards one move away from the given one; returns their count
+int packedNeighbours(uint64_t packed, uint64_t next[4])
+{
+    int dx[] = {-1, 0, 1, 0};
+    int dy[] = {0, 1, 0, -1};
+
+    int emptyPos = 0;
+    while ((packed >> (4 * emptyPos)) & 0xF)
+        emptyPos++;
+
+    int count = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        int newX = emptyPos / 3 + dx[i];
+        int newY = emptyPos % 3 + dy[i];
+        if (isValid(newX, newY))
+        {
+            // The empty nibble is zero, so moving the tile is a shift of its value
+            int tilePos = newX * 3 + newY;
+            uint64_t tile = (packed >> (4 * tilePos)) & 0xF;
+            next[count++] = packed - (tile << (4 * tilePos)) + (tile << (4 * emptyPos));
+        }
+    }
+    return count;
+}
+
 // Solve 8-puzzle using A* search algorithm
 vector<State *> solvePuzzle(const vector<vector<int>> &initial, const vector<vector<int>> &goal, bool useManhattan)
 {
@@ -107,6 +173,12 @@ vector<State *> solvePuzzle(const vector<vector<int>> &initial, const vector<vec
     int dx[] = {-1, 0, 1, 0};
     int dy[] = {0, 1, 0, -1};
 
+    // Half of all boards can never reach the goal; reject them without searching
+    if (!isSolvable(initial, goal))
+    {
+        return vector<State *>();
+    }
+
     priority_queue<State> pq;
     set<string> visited;
 
@@ -159,6 +231,105 @@ vector<State *> solvePuzzle(const vector<vector<int>> &initial, const vector<vec
     return vector<State *>(); // No solution found
 }
 
+/*
+    Bidirectional uniform-cost search. Every move costs 1, so uniform-cost search is a
+    BFS; here two BFS trees grow from the initial and the goal board and the smaller
+    frontier is expanded one full layer at a time.
+
+    Once a layer produces a board already seen from the other side, the cheapest such
+    meeting within that layer is optimal: a shorter path would have met in an earlier
+    layer. Each side explores a ball of radius about d/2 instead of the single ball of
+    radius d, i.e. roughly 2*b^(d/2) instead of b^d boards.
+*/
+struct SearchTree
+{
+    unordered_map<uint64_t, pair<uint64_t, int>> seen; // board -> (predecessor, depth)
+    vector<uint64_t> frontier;
+};
+
+vector<State *> solvePuzzleBidirectional(const vector<vector<int>> &initial, const vector<vector<int>> &goal, long long *expanded = nullptr)
+{
+    if (expanded)
+        *expanded = 0;
+    if (!isSolvable(initial, goal))
+    {
+        return vector<State *>();
+    }
+
+    uint64_t start = packBoard(initial);
+    uint64_t target = packBoard(goal);
+    if (start == target)
+    {
+        return vector<State *>();
+    }
+
+    SearchTree forward, backward;
+    forward.seen[start] = {start, 0};
+    forward.frontier.push_back(start);
+    backward.seen[target] = {target, 0};
+    backward.frontier.push_back(target);
+
+    uint64_t meeting = 0;
+    int bestLength = INT_MAX;
+    uint64_t next[4];
+
+    while (bestLength == INT_MAX && !forward.frontier.empty() && !backward.frontier.empty())
+    {
+        bool expandForward = forward.frontier.size() <= backward.frontier.size();
+        SearchTree &side = expandForward ? forward : backward;
+        SearchTree &other = expandForward ? backward : forward;
+
+        vector<uint64_t> layer;
+        for (uint64_t board : side.frontier)
+        {
+            if (expanded)
+                (*expanded)++;
+            int depth = side.seen[board].second + 1;
+            int count = packedNeighbours(board, next);
+            for (int i = 0; i < count; i++)
+            {
+                if (side.seen.count(next[i]))
+                    continue;
+                side.seen[next[i]] = {board, depth};
+                layer.push_back(next[i]);
+
+                auto it = other.seen.find(next[i]);
+                if (it != other.seen.end() && depth + it->second.second < bestLength)
+                {
+                    bestLength = depth + it->second.second;
+                    meeting = next[i];
+                }
+            }
+        }
+        side.frontier.swap(layer);
+    }
+
+    if (bestLength == INT_MAX)
+    {
+        return vector<State *>();
+    }
+
+    // initial ... meeting from the forward tree, then meeting ... goal from the backward tree
+    vector<uint64_t> boards;
+    for (uint64_t b = meeting; b != start; b = forward.seen[b].first)
+        boards.push_back(b);
+    reverse(boards.begin(), boards.end());
+    for (uint64_t b = meeting; b != target;)
+    {
+        b = backward.seen[b].first;
+        boards.push_back(b);
+    }
+
+    vector<State *> path;
+    for (uint64_t b : boards)
+    {
+        State *state = new State(unpackBoard(b));
+        state->g = path.size() + 1;
+        path.push_back(state);
+    }
+    return path;
+}
+
 // Print board state
 void printBoard(const vector<vector<int>> &board)
 {
@@ -183,7 +354,18 @@ int main(int argc, char *argv[])
     vector<vector<int>> initial(3, vector<int>(3, 0));
     vector<vector<int>> goal(3, vector<int>(3, 0));
 
-    if (argc > 1)
+    // --bidirectional searches from both ends, any other argument reads the boards
+    bool interactive = false;
+    bool bidirectional = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (string(argv[i]) == "--bidirectional")
+            bidirectional = true;
+        else
+            interactive = true;
+    }
+
+    if (interactive)
     {
         cout << "Enter the values of cells in initial matrix\n";
         for (int i = 0; i < 3; i++)
@@ -221,6 +403,22 @@ int main(int argc, char *argv[])
     cout << "Goal State:\n";
     printBoard(goal);
 
+    if (bidirectional)
+    {
+        cout << "Solving using bidirectional search...\n";
+        long long expanded = 0;
+        vector<State *> solution = solvePuzzleBidirectional(initial, goal, &expanded);
+        if (!solution.empty())
+        {
+            cout << "Solution found in " << solution.size() << " moves (" << expanded << " boards expanded)!\n";
+            for (State *state : solution)
+            {
+                printBoard(state->board);
+            }
+        }
+        return 0;
+    }
+
     cout << "Solving using Misplaced Tiles heuristic...\n";
     vector<State *> solution1 = solvePuzzle(initial, goal, false);
     if (!solution1.empty())
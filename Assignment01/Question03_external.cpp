@@ -0,0 +1,471 @@
+/*
+    External-memory breadth-first search over the whole sliding tile puzzle space.
+
+    The 15-puzzle has 16!/2 (about 10^13) reachable boards, far more than a
+    set<string> in RAM can hold. Here every layer of the BFS (all boards at the same
+    distance from the goal) lives in a file of sorted, duplicate-free packed boards
+    (4 bits per cell in a uint64), and only a bounded buffer is kept in memory:
+
+        1. Layer d is streamed from disk and the successors of each board are
+           collected in the buffer. A full buffer is sorted, deduplicated and
+           written out as a sorted run.
+        2. The runs are merged into layer d+1, at most MAX_FAN_IN at a time
+           (more runs are first merged into fewer, larger ones), with the
+           --memory budget shared by the open readers. Duplicates inside the
+           layer are dropped during the merge, and boards of layer d-1 are
+           dropped by streaming that layer alongside in the last pass (delayed
+           duplicate detection).
+
+    Every move changes the colour of the empty cell on a chessboard colouring, so
+    the puzzle graph is bipartite and the successors of layer d lie only in layers
+    d-1 and d+1; subtracting layer d-1 is therefore enough.
+
+    Completed layers are recorded in a manifest, so an interrupted run resumes at
+    the first unfinished layer. The manifest doubles as the depth distribution, and
+    the last layer holds the hardest positions.
+*/
+#include <bits/stdc++.h>
+
+using namespace std;
+
+static const size_t MAX_FAN_IN = 64;     // runs merged at once (one open file each)
+static const size_t MIN_BLOCK = 1 << 12; // smallest read/write block, in boards (32 KB)
+
+// Sequential reader of a file of packed boards
+class BoardReader
+{
+private:
+    FILE *file;
+    vector<uint64_t> block;
+    size_t pos = 0, count = 0;
+
+public:
+    BoardReader(const string &path, size_t blockBoards) : block(blockBoards)
+    {
+        file = fopen(path.c_str(), "rb");
+        if (!file)
+            throw runtime_error("cannot read " + path);
+    }
+
+    ~BoardReader()
+    {
+        if (file)
+            fclose(file);
+    }
+
+    bool next(uint64_t &board)
+    {
+        if (pos == count)
+        {
+            count = fread(block.data(), sizeof(uint64_t), block.size(), file);
+            pos = 0;
+            if (count == 0)
+                return false;
+        }
+        board = block[pos++];
+        return true;
+    }
+};
+
+// Sequential writer of a file of packed boards
+class BoardWriter
+{
+private:
+    FILE *file;
+    vector<uint64_t> block;
+    size_t blockBoards;
+
+public:
+    long long written = 0;
+
+    BoardWriter(const string &path, size_t blockBoards) : blockBoards(blockBoards)
+    {
+        file = fopen(path.c_str(), "wb");
+        if (!file)
+            throw runtime_error("cannot write " + path);
+        block.reserve(blockBoards);
+    }
+
+    ~BoardWriter()
+    {
+        close();
+    }
+
+    void write(uint64_t board)
+    {
+        block.push_back(board);
+        written++;
+        if (block.size() == blockBoards)
+            flush();
+    }
+
+    void flush()
+    {
+        if (file && !block.empty() && fwrite(block.data(), sizeof(uint64_t), block.size(), file) != block.size())
+            throw runtime_error("write failed");
+        block.clear();
+    }
+
+    void close()
+    {
+        if (file)
+        {
+            flush();
+            fclose(file);
+            file = nullptr;
+        }
+    }
+};
+
+class ExternalBFS
+{
+private:
+    int n;
+    string dir;
+    size_t bufferBoards;  // boards held in memory while generating a layer
+    size_t fanIn;         // runs merged per pass
+    size_t blockBoards;   // read/write block of each open file; fanIn + 2 of them fit in the buffer
+    vector<long long> counts; // counts[d] = boards at distance d (completed layers)
+    bool keepLayers;
+
+    string layerPath(int depth) const
+    {
+        return dir + "/layer_" + to_string(depth) + ".bin";
+    }
+
+    string runPath(int depth, int pass, int run) const
+    {
+        return dir + "/run_" + to_string(depth) + "_" + to_string(pass) + "_" + to_string(run) + ".bin";
+    }
+
+    string manifestPath() const
+    {
+        return dir + "/manifest.txt";
+    }
+
+    int emptyPos(uint64_t packed) const
+    {
+        int pos = 0;
+        while ((packed >> (4 * pos)) & 0xF)
+            pos++;
+        return pos;
+    }
+
+    int neighbours(uint64_t packed, uint64_t next[4]) const
+    {
+        int dx[] = {-1, 0, 1, 0};
+        int dy[] = {0, 1, 0, -1};
+
+        int empty = emptyPos(packed);
+        int count = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            int newX = empty / n + dx[i];
+            int newY = empty % n + dy[i];
+            if (newX >= 0 && newX < n && newY >= 0 && newY < n)
+            {
+                int tilePos = newX * n + newY;
+                uint64_t tile = (packed >> (4 * tilePos)) & 0xF;
+                next[count++] = packed - (tile << (4 * tilePos)) + (tile << (4 * empty));
+            }
+        }
+        return count;
+    }
+
+    // The manifest is rewritten through a temporary file so it is never half written
+    void saveManifest() const
+    {
+        string tmp = manifestPath() + ".tmp";
+        {
+            ofstream out(tmp);
+            out << n << "\n";
+            for (long long count : counts)
+                out << count << "\n";
+        }
+        filesystem::rename(tmp, manifestPath());
+    }
+
+    bool loadManifest()
+    {
+        ifstream in(manifestPath());
+        int size;
+        if (!(in >> size) || size != n)
+            return false;
+        long long count;
+        while (in >> count)
+            counts.push_back(count);
+        return !counts.empty();
+    }
+
+    void writeRun(vector<uint64_t> &buffer, int depth, int run)
+    {
+        sort(buffer.begin(), buffer.end());
+        buffer.erase(unique(buffer.begin(), buffer.end()), buffer.end());
+        BoardWriter writer(runPath(depth, 0, run), blockBoards);
+        for (uint64_t board : buffer)
+            writer.write(board);
+        buffer.clear();
+    }
+
+    /*
+        Merges sorted runs into one sorted, duplicate-free file and deletes the
+        runs. Boards found in `subtract` (a sorted layer; empty path for none) are
+        left out. Returns the number of boards written.
+    */
+    long long mergeRuns(const vector<string> &runs, const string &output, const string &subtract)
+    {
+        vector<unique_ptr<BoardReader>> readers;
+        priority_queue<pair<uint64_t, int>, vector<pair<uint64_t, int>>, greater<pair<uint64_t, int>>> heads;
+        uint64_t board;
+        for (size_t r = 0; r < runs.size(); r++)
+        {
+            readers.push_back(make_unique<BoardReader>(runs[r], blockBoards));
+            if (readers[r]->next(board))
+                heads.push({board, (int)r});
+        }
+
+        unique_ptr<BoardReader> previous;
+        uint64_t previousBoard = 0;
+        bool hasPrevious = false;
+        if (!subtract.empty())
+        {
+            previous = make_unique<BoardReader>(subtract, blockBoards);
+            hasPrevious = previous->next(previousBoard);
+        }
+
+        BoardWriter out(output, blockBoards);
+        bool hasLast = false;
+        uint64_t last = 0;
+        while (!heads.empty())
+        {
+            auto [current, r] = heads.top();
+            heads.pop();
+            if (readers[r]->next(board))
+                heads.push({board, r});
+
+            if (hasLast && current == last)
+                continue;
+            hasLast = true;
+            last = current;
+
+            while (hasPrevious && previousBoard < current)
+                hasPrevious = previous->next(previousBoard);
+            if (hasPrevious && previousBoard == current)
+                continue;
+            out.write(current);
+        }
+        out.close();
+
+        readers.clear();
+        for (const string &run : runs)
+            filesystem::remove(run);
+        return out.written;
+    }
+
+    // Builds layer depth+1 from layer depth and subtracts layer depth-1
+    long long expandLayer(int depth)
+    {
+        vector<uint64_t> buffer;
+        buffer.reserve(bufferBoards);
+        int runs = 0;
+
+        {
+            BoardReader layer(layerPath(depth), blockBoards);
+            uint64_t board, next[4];
+            while (layer.next(board))
+            {
+                if (buffer.size() + 4 > bufferBoards)
+                    writeRun(buffer, depth + 1, runs++);
+                int count = neighbours(board, next);
+                buffer.insert(buffer.end(), next, next + count);
+            }
+            if (!buffer.empty())
+                writeRun(buffer, depth + 1, runs++);
+        }
+        vector<uint64_t>().swap(buffer);
+
+        vector<string> pending;
+        for (int r = 0; r < runs; r++)
+            pending.push_back(runPath(depth + 1, 0, r));
+
+        // Merge groups of fanIn runs until one final merge is left
+        for (int pass = 1; pending.size() > fanIn; pass++)
+        {
+            vector<string> merged;
+            for (size_t first = 0; first < pending.size(); first += fanIn)
+            {
+                vector<string> group(pending.begin() + first, pending.begin() + min(pending.size(), first + fanIn));
+                merged.push_back(runPath(depth + 1, pass, merged.size()));
+                mergeRuns(group, merged.back(), "");
+            }
+            pending = merged;
+        }
+
+        // No layer above the first one
+        string subtract = depth > 0 ? layerPath(depth - 1) : "";
+        long long written = mergeRuns(pending, layerPath(depth + 1) + ".tmp", subtract);
+        filesystem::rename(layerPath(depth + 1) + ".tmp", layerPath(depth + 1));
+        return written;
+    }
+
+public:
+    ExternalBFS(int n, const string &dir, size_t memoryMB, bool keepLayers)
+        : n(n), dir(dir), bufferBoards(max<size_t>(memoryMB * (1 << 20) / sizeof(uint64_t), 1024)), keepLayers(keepLayers)
+    {
+        size_t blocks = bufferBoards / MIN_BLOCK;
+        fanIn = blocks > 4 ? min(MAX_FAN_IN, blocks - 2) : 2;
+        blockBoards = max(MIN_BLOCK, bufferBoards / (fanIn + 2));
+    }
+
+    uint64_t goal() const
+    {
+        uint64_t packed = 0;
+        for (int i = 0; i < n * n - 1; i++)
+            packed |= (uint64_t)(i + 1) << (4 * i);
+        return packed;
+    }
+
+    const vector<long long> &distribution() const
+    {
+        return counts;
+    }
+
+    // Deepest completed layer that is not empty
+    int deepest() const
+    {
+        int depth = counts.size() - 1;
+        while (depth > 0 && counts[depth] == 0)
+            depth--;
+        return depth;
+    }
+
+    // Runs (or resumes) the BFS until the space is exhausted or maxDepth is reached
+    void run(int maxDepth)
+    {
+        filesystem::create_directories(dir);
+        if (loadManifest())
+        {
+            // Runs and unfinished layers of an interrupted expansion are regenerated
+            for (const auto &entry : filesystem::directory_iterator(dir))
+            {
+                string name = entry.path().filename().string();
+                if (name.rfind("run_", 0) == 0 || (name.size() > 4 && name.substr(name.size() - 4) == ".tmp"))
+                    filesystem::remove(entry.path());
+            }
+            cout << "Resuming after layer " << counts.size() - 1 << "\n";
+        }
+        else
+        {
+            counts.clear();
+            BoardWriter first(layerPath(0), blockBoards);
+            first.write(goal());
+            first.close();
+            counts.push_back(1);
+            saveManifest();
+        }
+
+        while ((int)counts.size() - 1 < maxDepth && counts.back() > 0)
+        {
+            int depth = counts.size() - 1;
+            auto begin = chrono::steady_clock::now();
+            long long count = expandLayer(depth);
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+            // An empty layer is recorded too, so a finished run is not resumed
+            counts.push_back(count);
+            saveManifest();
+            if (count == 0)
+            {
+                filesystem::remove(layerPath(depth + 1));
+                break;
+            }
+            if (!keepLayers && depth >= 1)
+                filesystem::remove(layerPath(depth - 1));
+            cout << "Layer " << depth + 1 << ": " << count << " boards (" << fixed << setprecision(2) << seconds << " s)\n";
+        }
+    }
+
+    // Up to limit boards of the deepest completed layer
+    vector<uint64_t> hardest(size_t limit) const
+    {
+        vector<uint64_t> boards;
+        BoardReader reader(layerPath(deepest()), blockBoards);
+        uint64_t board;
+        while (boards.size() < limit && reader.next(board))
+            boards.push_back(board);
+        return boards;
+    }
+
+    void printBoard(uint64_t packed) const
+    {
+        for (int i = 0; i < n; i++)
+        {
+            cout << "|";
+            for (int j = 0; j < n; j++)
+            {
+                int tile = (packed >> (4 * (i * n + j))) & 0xF;
+                if (tile == 0)
+                    cout << "    |";
+                else
+                    cout << " " << setw(2) << tile << " |";
+            }
+            cout << "\n";
+        }
+        cout << "\n";
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    int n = 3;
+    string dir;
+    size_t memoryMB = 256;
+    int maxDepth = INT_MAX;
+    bool keepLayers = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc)
+            n = atoi(argv[++i]);
+        else if (arg == "--dir" && i + 1 < argc)
+            dir = argv[++i];
+        else if (arg == "--memory" && i + 1 < argc)
+            memoryMB = atol(argv[++i]);
+        else if (arg == "--max-depth" && i + 1 < argc)
+            maxDepth = atoi(argv[++i]);
+        else if (arg == "--keep-layers")
+            keepLayers = true;
+        else
+        {
+            cout << "Usage: " << argv[0] << " [--size 3|4] [--dir path] [--memory MB] [--max-depth d] [--keep-layers]\n";
+            return 0;
+        }
+    }
+    if (n != 3 && n != 4)
+    {
+        cout << "Only 3x3 and 4x4 boards are supported\n";
+        return 0;
+    }
+    if (dir.empty())
+        dir = "ebfs_" + to_string(n) + "x" + to_string(n);
+
+    ExternalBFS bfs(n, dir, memoryMB, keepLayers);
+    bfs.run(maxDepth);
+
+    const vector<long long> &counts = bfs.distribution();
+    long long total = 0;
+    cout << "\nDepth distribution:\n";
+    for (int d = 0; d <= bfs.deepest(); d++)
+    {
+        cout << setw(4) << d << " : " << counts[d] << "\n";
+        total += counts[d];
+    }
+    cout << "Total boards: " << total << "\n";
+
+    cout << "\nPositions at depth " << bfs.deepest() << ":\n";
+    for (uint64_t board : bfs.hardest(5))
+        bfs.printBoard(board);
+
+    return 0;
+}
@@ -0,0 +1,502 @@
+/*
+    Hash-distributed A* (HDA*) for the sliding tile puzzles (8-puzzle and 15-puzzle).
+
+    Every board is packed into 4 bits per cell of a 64 bit word, so both sizes fit in
+    one integer. The state space is partitioned between the worker threads by a
+    Zobrist hash of the packed board: the owner of a board keeps its open list entry
+    and its best g value, and is the only thread that ever expands it.
+
+    A worker that generates a board owned by another worker buffers it and sends the
+    buffer through the owner's inbox, a lock-free multi-producer single-consumer
+    queue. Once a goal has been expanded its cost is the incumbent, and nodes with
+    f >= incumbent are pruned everywhere.
+
+    Termination: a worker is idle when its open list has nothing below the incumbent.
+    Every sent buffer is counted in `inFlight`, and the receiver only subtracts the
+    buffers it has consumed when it becomes idle again, so while any worker is still
+    busy because of a message the count stays positive. All workers idle together
+    with no buffer in flight therefore means no node below the incumbent is left
+    anywhere and the incumbent is optimal (Manhattan distance is admissible).
+*/
+#include <bits/stdc++.h>
+
+using namespace std;
+
+// A generated node travelling to its owner
+struct Entry
+{
+    uint64_t board;
+    uint64_t parent;
+    int g;
+};
+
+// A buffer of entries, linked into the receiver's inbox
+struct Message
+{
+    vector<Entry> entries;
+    Message *next = nullptr;
+};
+
+// Lock-free MPSC queue: producers push with a CAS, the owner takes everything at once
+class Inbox
+{
+private:
+    atomic<Message *> head{nullptr};
+
+public:
+    void push(Message *message)
+    {
+        Message *old = head.load(memory_order_relaxed);
+        do
+        {
+            message->next = old;
+        } while (!head.compare_exchange_weak(old, message, memory_order_release, memory_order_relaxed));
+    }
+
+    Message *takeAll()
+    {
+        return head.exchange(nullptr, memory_order_acquire);
+    }
+};
+
+class SlidingPuzzle
+{
+public:
+    int n;         // board width (3 or 4)
+    uint64_t goal; // packed goal board
+    int goalRow[16], goalCol[16];
+
+    SlidingPuzzle(int n, const vector<vector<int>> &goalBoard) : n(n)
+    {
+        goal = pack(goalBoard);
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                goalRow[goalBoard[i][j]] = i;
+                goalCol[goalBoard[i][j]] = j;
+            }
+        }
+    }
+
+    uint64_t pack(const vector<vector<int>> &board) const
+    {
+        uint64_t packed = 0;
+        for (int i = 0; i < n * n; i++)
+            packed |= (uint64_t)board[i / n][i % n] << (4 * i);
+        return packed;
+    }
+
+    vector<vector<int>> unpack(uint64_t packed) const
+    {
+        vector<vector<int>> board(n, vector<int>(n));
+        for (int i = 0; i < n * n; i++)
+            board[i / n][i % n] = (packed >> (4 * i)) & 0xF;
+        return board;
+    }
+
+    int emptyPos(uint64_t packed) const
+    {
+        int pos = 0;
+        while ((packed >> (4 * pos)) & 0xF)
+            pos++;
+        return pos;
+    }
+
+    int manhattan(uint64_t packed) const
+    {
+        int distance = 0;
+        for (int i = 0; i < n * n; i++)
+        {
+            int tile = (packed >> (4 * i)) & 0xF;
+            if (tile != 0)
+                distance += abs(i / n - goalRow[tile]) + abs(i % n - goalCol[tile]);
+        }
+        return distance;
+    }
+
+    // Boards one move away; returns their count
+    int neighbours(uint64_t packed, uint64_t next[4]) const
+    {
+        int dx[] = {-1, 0, 1, 0};
+        int dy[] = {0, 1, 0, -1};
+
+        int empty = emptyPos(packed);
+        int count = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            int newX = empty / n + dx[i];
+            int newY = empty % n + dy[i];
+            if (newX >= 0 && newX < n && newY >= 0 && newY < n)
+            {
+                // The empty nibble is zero, so moving the tile is a shift of its value
+                int tilePos = newX * n + newY;
+                uint64_t tile = (packed >> (4 * tilePos)) & 0xF;
+                next[count++] = packed - (tile << (4 * tilePos)) + (tile << (4 * empty));
+            }
+        }
+        return count;
+    }
+
+    /*
+        Solvability test against the goal: on odd widths the tile inversion parity is
+        invariant; on even widths a vertical move also changes the empty row, so the
+        invariant is the parity of inversions plus the row of the empty cell.
+    */
+    int parity(uint64_t packed) const
+    {
+        int tiles[16], count = 0;
+        for (int i = 0; i < n * n; i++)
+        {
+            int tile = (packed >> (4 * i)) & 0xF;
+            if (tile != 0)
+                tiles[count++] = tile;
+        }
+        int inversions = 0;
+        for (int i = 0; i < count; i++)
+            for (int j = i + 1; j < count; j++)
+                if (tiles[i] > tiles[j])
+                    inversions++;
+        if (n % 2 == 0)
+            inversions += emptyPos(packed) / n;
+        return inversions % 2;
+    }
+
+    bool isSolvable(uint64_t initial) const
+    {
+        return parity(initial) == parity(goal);
+    }
+};
+
+class HdaStar
+{
+private:
+    static const int BATCH = 64;          // entries per message
+    static const int FLUSH_INTERVAL = 32; // expansions between forced outbox flushes
+
+    struct OpenEntry
+    {
+        int f, g;
+        uint64_t board;
+
+        bool operator<(const OpenEntry &other) const
+        {
+            if (f != other.f)
+                return f > other.f;
+            return g < other.g; // deeper first among equal f
+        }
+    };
+
+    struct Worker
+    {
+        Inbox inbox;
+        priority_queue<OpenEntry> open;
+        unordered_map<uint64_t, pair<int, uint64_t>> table; // board -> (best g, parent)
+        vector<vector<Entry>> outbox;
+        long long expanded = 0;
+    };
+
+    const SlidingPuzzle &puzzle;
+    int nWorkers;
+    vector<unique_ptr<Worker>> workers;
+    uint64_t zobrist[16][16];
+
+    atomic<int> incumbent{INT_MAX};
+    atomic<long long> inFlight{0};
+    atomic<int> idleCount{0};
+    atomic<bool> done{false};
+
+    int owner(uint64_t board) const
+    {
+        uint64_t hash = 0;
+        for (int i = 0; i < puzzle.n * puzzle.n; i++)
+            hash ^= zobrist[i][(board >> (4 * i)) & 0xF];
+        return hash % nWorkers;
+    }
+
+    void send(int to, vector<Entry> &entries)
+    {
+        if (entries.empty())
+            return;
+        Message *message = new Message();
+        message->entries.swap(entries);
+        entries.reserve(BATCH);
+        inFlight.fetch_add(1);
+        workers[to]->inbox.push(message);
+    }
+
+    // Keeps the entry if it improves the owner's best g for the board
+    void insert(Worker &worker, const Entry &entry)
+    {
+        auto it = worker.table.find(entry.board);
+        if (it != worker.table.end() && it->second.first <= entry.g)
+            return;
+        worker.table[entry.board] = {entry.g, entry.parent};
+        int f = entry.g + puzzle.manhattan(entry.board);
+        if (f < incumbent.load(memory_order_relaxed))
+            worker.open.push({f, entry.g, entry.board});
+    }
+
+    void run(int id)
+    {
+        Worker &self = *workers[id];
+        bool idle = false;
+        long long received = 0; // messages consumed since the worker last became idle
+        uint64_t next[4];
+
+        while (!done.load())
+        {
+            for (Message *message = self.inbox.takeAll(); message != nullptr;)
+            {
+                for (const Entry &entry : message->entries)
+                    insert(self, entry);
+                Message *consumed = message;
+                message = message->next;
+                delete consumed;
+                received++;
+            }
+
+            if (!self.open.empty() && self.open.top().f < incumbent.load())
+            {
+                if (idle)
+                {
+                    idle = false;
+                    idleCount.fetch_sub(1);
+                }
+
+                OpenEntry current = self.open.top();
+                self.open.pop();
+                auto &best = self.table[current.board];
+                if (current.g > best.first)
+                    continue; // stale entry
+
+                if (current.board == puzzle.goal)
+                {
+                    int cost = incumbent.load();
+                    while (current.g < cost && !incumbent.compare_exchange_weak(cost, current.g))
+                        ;
+                    continue;
+                }
+
+                self.expanded++;
+                uint64_t parent = best.second;
+                int count = puzzle.neighbours(current.board, next);
+                for (int i = 0; i < count; i++)
+                {
+                    if (next[i] == parent)
+                        continue;
+                    Entry entry{next[i], current.board, current.g + 1};
+                    int to = owner(next[i]);
+                    if (to == id)
+                    {
+                        insert(self, entry);
+                    }
+                    else
+                    {
+                        self.outbox[to].push_back(entry);
+                        if (self.outbox[to].size() >= BATCH)
+                            send(to, self.outbox[to]);
+                    }
+                }
+
+                if (self.expanded % FLUSH_INTERVAL == 0)
+                {
+                    for (int to = 0; to < nWorkers; to++)
+                        send(to, self.outbox[to]);
+                }
+                continue;
+            }
+
+            // Nothing below the incumbent: hand over buffered work, then report idle
+            for (int to = 0; to < nWorkers; to++)
+                send(to, self.outbox[to]);
+            if (!idle)
+            {
+                idle = true;
+                idleCount.fetch_add(1);
+            }
+            inFlight.fetch_sub(received);
+            received = 0;
+
+            if (idleCount.load() == nWorkers && inFlight.load() == 0)
+                done.store(true);
+            else
+                this_thread::yield();
+        }
+    }
+
+public:
+    HdaStar(const SlidingPuzzle &puzzle, int nWorkers) : puzzle(puzzle), nWorkers(nWorkers)
+    {
+        mt19937_64 rng(0x8B0A2D3F);
+        for (int i = 0; i < 16; i++)
+            for (int j = 0; j < 16; j++)
+                zobrist[i][j] = rng();
+    }
+
+    long long expanded = 0; // total expansions of the last solve
+
+    // Optimal sequence of boards after each move; empty if the goal is unreachable
+    vector<uint64_t> solve(uint64_t initial)
+    {
+        expanded = 0;
+        if (!puzzle.isSolvable(initial) || initial == puzzle.goal)
+            return {};
+
+        workers.clear();
+        for (int i = 0; i < nWorkers; i++)
+        {
+            workers.push_back(make_unique<Worker>());
+            workers[i]->outbox.assign(nWorkers, vector<Entry>());
+        }
+        incumbent = INT_MAX;
+        idleCount = 0;
+        done = false;
+        inFlight = 0;
+
+        vector<Entry> start = {{initial, initial, 0}};
+        send(owner(initial), start);
+
+        vector<thread> threads;
+        for (int i = 0; i < nWorkers; i++)
+            threads.emplace_back(&HdaStar::run, this, i);
+        for (thread &t : threads)
+            t.join();
+
+        for (auto &worker : workers)
+            expanded += worker->expanded;
+        if (incumbent == INT_MAX)
+            return {};
+
+        // Every parent link points to a board with a smaller g, so this reaches the start
+        vector<uint64_t> path;
+        for (uint64_t board = puzzle.goal; board != initial;)
+        {
+            path.push_back(board);
+            board = workers[owner(board)]->table[board].second;
+        }
+        reverse(path.begin(), path.end());
+        return path;
+    }
+};
+
+// Print board state
+void printBoard(const vector<vector<int>> &board)
+{
+    int n = board.size();
+    string separator(5 * n + 1, '-');
+    cout << separator << "\n";
+    for (int i = 0; i < n; i++)
+    {
+        cout << "|";
+        for (int j = 0; j < n; j++)
+        {
+            if (board[i][j] == 0)
+                cout << "    |";
+            else
+                cout << " " << setw(2) << board[i][j] << " |";
+        }
+        cout << "\n"
+             << separator << "\n";
+    }
+    cout << "\n";
+}
+
+// Direction the empty cell moved between two consecutive boards
+char moveName(const SlidingPuzzle &puzzle, uint64_t from, uint64_t to)
+{
+    int a = puzzle.emptyPos(from), b = puzzle.emptyPos(to);
+    if (b == a - puzzle.n)
+        return 'U';
+    if (b == a + puzzle.n)
+        return 'D';
+    return b == a - 1 ? 'L' : 'R';
+}
+
+int main(int argc, char *argv[])
+{
+    int n = 4;
+    int nThreads = max(1u, thread::hardware_concurrency());
+    vector<vector<int>> initial = {
+        {5, 1, 6, 9},
+        {11, 0, 10, 2},
+        {12, 3, 4, 14},
+        {15, 13, 8, 7}};
+    vector<vector<int>> goal = {
+        {1, 2, 3, 4},
+        {5, 6, 7, 8},
+        {9, 10, 11, 12},
+        {13, 14, 15, 0}};
+
+    // --threads k sets the worker count, any other argument reads the boards
+    bool interactive = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (string(argv[i]) == "--threads" && i + 1 < argc)
+            nThreads = max(1, atoi(argv[++i]));
+        else
+            interactive = true;
+    }
+
+    if (interactive)
+    {
+        cout << "Enter the board width (3 or 4):\n";
+        cin >> n;
+        if (n != 3 && n != 4)
+        {
+            cout << "Only 3x3 and 4x4 boards are supported\n";
+            return 0;
+        }
+        initial.assign(n, vector<int>(n, 0));
+        goal.assign(n, vector<int>(n, 0));
+        cout << "Enter the values of cells in initial matrix\n";
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                cout << "Row " << i + 1 << " Column " << j + 1 << ": ";
+                cin >> initial[i][j];
+            }
+        }
+        cout << "Enter the values of cells in goal matrix\n";
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                cout << "Row " << i + 1 << " Column " << j + 1 << ": ";
+                cin >> goal[i][j];
+            }
+        }
+    }
+
+    cout << "Initial State:\n";
+    printBoard(initial);
+    cout << "Goal State:\n";
+    printBoard(goal);
+
+    SlidingPuzzle puzzle(n, goal);
+    uint64_t start = puzzle.pack(initial);
+    if (!puzzle.isSolvable(start))
+    {
+        cout << "The goal state cannot be reached from the initial state\n";
+        return 0;
+    }
+
+    cout << "Solving using HDA* with " << nThreads << " threads...\n";
+    HdaStar solver(puzzle, nThreads);
+    auto begin = chrono::steady_clock::now();
+    vector<uint64_t> solution = solver.solve(start);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    string moves;
+    uint64_t previous = start;
+    for (uint64_t board : solution)
+    {
+        moves += moveName(puzzle, previous, board);
+        previous = board;
+    }
+    cout << "Solution found in " << solution.size() << " moves: " << moves << "\n";
+    cout << "Nodes expanded: " << solver.expanded << " in " << fixed << setprecision(3) << seconds << " s\n";
+
+    return 0;
+}
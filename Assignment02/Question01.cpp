@@ -12,156 +12,2898 @@
 */
 
 #include <bits/stdc++.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 using namespace std;
 
-struct Node
+/*
+    Passability bitmap: one bit per cell, 1 = free, 0 = obstacle.
+
+    Rows are padded with a blocked border (one column on each side, one row above
+    and below), so the 3x3 neighbourhood of any cell can be read without bounds
+    checks. Cell (x, y) is bit x + 1 of row y + 1, rows are `wordsPerRow` 64 bit
+    words apart.
+
+    The binary file holds a 64 byte header followed by exactly this padded layout,
+    so a map can be mmap'ed and used directly. The mapping is private: cells can
+    still be changed in memory without touching the file.
+*/
+class GridBitmap
+{
+private:
+    static constexpr char MAGIC[8] = {'G', 'R', 'I', 'D', 'B', 'I', 'T', 'S'};
+    static constexpr size_t HEADER_BYTES = 64;
+
+    int width = 0, height = 0;
+    size_t wordsPerRow = 0;
+    vector<uint64_t> owned;     // storage when the map is not mapped from a file
+    uint64_t *bits = nullptr;   // first word of the padded row above the map
+    void *mapping = nullptr;
+    size_t mappingBytes = 0;
+
+    void allocate(int w, int h)
+    {
+        width = w;
+        height = h;
+        wordsPerRow = (w + 2 + 63) / 64;
+        owned.assign(wordsPerRow * (h + 2), 0);
+        bits = owned.data();
+    }
+
+    void release()
+    {
+        if (mapping)
+            munmap(mapping, mappingBytes);
+        mapping = nullptr;
+        mappingBytes = 0;
+    }
+
+    // Bits x-1, x, x+1 of row y (in bits 0, 1, 2)
+    unsigned threeBits(int x, int y) const
+    {
+        const uint64_t *row = bits + (size_t)(y + 1) * wordsPerRow;
+        size_t bit = x; // column x-1 is stored at bit x
+        uint64_t value = row[bit / 64] >> (bit % 64);
+        if (bit % 64 > 61)
+            value |= row[bit / 64 + 1] << (64 - bit % 64);
+        return value & 7;
+    }
+
+public:
+    GridBitmap() {}
+
+    // A w x h map with every cell blocked
+    GridBitmap(int w, int h)
+    {
+        allocate(w, h);
+    }
+
+    // From the grid format used by main: grid[y][x] != 0 is free
+    GridBitmap(int w, int h, const vector<vector<int>> &cells)
+    {
+        allocate(w, h);
+        for (int y = 0; y < h; y++)
+            for (int x = 0; x < w; x++)
+                if (cells[y][x] != 0)
+                    set(x, y, true);
+    }
+
+    GridBitmap(const GridBitmap &other)
+    {
+        *this = other;
+    }
+
+    GridBitmap(GridBitmap &&other) noexcept
+    {
+        *this = move(other);
+    }
+
+    GridBitmap &operator=(const GridBitmap &other)
+    {
+        if (this != &other)
+        {
+            release();
+            width = other.width;
+            height = other.height;
+            wordsPerRow = other.wordsPerRow;
+            owned.assign(other.bits, other.bits + wordsPerRow * (height + 2));
+            bits = owned.data();
+        }
+        return *this;
+    }
+
+    GridBitmap &operator=(GridBitmap &&other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            width = other.width;
+            height = other.height;
+            wordsPerRow = other.wordsPerRow;
+            owned = move(other.owned);
+            bits = other.mapping ? other.bits : owned.data();
+            mapping = other.mapping;
+            mappingBytes = other.mappingBytes;
+            other.mapping = nullptr;
+            other.bits = nullptr;
+        }
+        return *this;
+    }
+
+    ~GridBitmap()
+    {
+        release();
+    }
+
+    int getWidth() const
+    {
+        return width;
+    }
+
+    int getHeight() const
+    {
+        return height;
+    }
+
+    // Callers check bounds; the padding makes one cell outside the map read as blocked
+    bool passable(int x, int y) const
+    {
+        const uint64_t *row = bits + (size_t)(y + 1) * wordsPerRow;
+        return (row[(x + 1) / 64] >> ((x + 1) % 64)) & 1;
+    }
+
+    void set(int x, int y, bool free)
+    {
+        uint64_t *row = bits + (size_t)(y + 1) * wordsPerRow;
+        uint64_t bit = 1ULL << ((x + 1) % 64);
+        if (free)
+            row[(x + 1) / 64] |= bit;
+        else
+            row[(x + 1) / 64] &= ~bit;
+    }
+
+    /*
+        Passable neighbours of (x, y) as 8 bits, bit i for the i-th direction of
+        {-1,0},{1,0},{0,-1},{0,1},{-1,-1},{-1,1},{1,-1},{1,1}, read with three word
+        accesses instead of eight separate tests.
+    */
+    unsigned neighbourMask(int x, int y) const
+    {
+        unsigned above = threeBits(x, y - 1);
+        unsigned middle = threeBits(x, y);
+        unsigned below = threeBits(x, y + 1);
+        return (middle & 1) | ((middle >> 2 & 1) << 1) | ((above >> 1 & 1) << 2) | ((below >> 1 & 1) << 3) |
+               ((above & 1) << 4) | ((below & 1) << 5) | ((above >> 2 & 1) << 6) | ((below >> 2 & 1) << 7);
+    }
+
+    /*
+        Maximal runs of free cells in row y as [begin, end) column ranges, found a
+        word at a time by counting trailing zeros of the row and of its complement.
+        The blocked border ends every run inside the row's words.
+    */
+    void freeRuns(int y, vector<pair<int, int>> &runs) const
+    {
+        runs.clear();
+        const uint64_t *row = bits + (size_t)(y + 1) * wordsPerRow;
+        int start = -1; // bit where the current run began, -1 outside a run
+        for (size_t w = 0; w < wordsPerRow; w++)
+        {
+            int pos = 0;
+            while (pos < 64)
+            {
+                uint64_t rest = (start < 0 ? row[w] : ~row[w]) >> pos;
+                if (rest == 0)
+                    break;
+                pos += __builtin_ctzll(rest);
+                if (start < 0)
+                    start = w * 64 + pos;
+                else
+                {
+                    // Bit b holds column b - 1
+                    runs.push_back({start - 1, (int)(w * 64 + pos) - 1});
+                    start = -1;
+                }
+            }
+        }
+    }
+
+    bool save(const string &path) const
+    {
+        ofstream out(path, ios::binary);
+        if (!out)
+            return false;
+        char header[HEADER_BYTES] = {};
+        memcpy(header, MAGIC, sizeof(MAGIC));
+        uint64_t fields[3] = {(uint64_t)width, (uint64_t)height, (uint64_t)wordsPerRow};
+        memcpy(header + 8, fields, sizeof(fields));
+        out.write(header, HEADER_BYTES);
+        out.write((const char *)bits, wordsPerRow * (height + 2) * sizeof(uint64_t));
+        return (bool)out;
+    }
+
+    // Maps a file written by save(); throws if it cannot be opened or is not a bitmap
+    static GridBitmap load(const string &path)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw runtime_error("cannot open " + path);
+        struct stat info;
+        fstat(fd, &info);
+
+        GridBitmap map;
+        if (info.st_size >= (off_t)HEADER_BYTES)
+        {
+            map.mappingBytes = info.st_size;
+            map.mapping = mmap(nullptr, map.mappingBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        if (map.mapping == nullptr || map.mapping == MAP_FAILED)
+        {
+            map.mapping = nullptr;
+            throw runtime_error("cannot map " + path);
+        }
+
+        const char *header = (const char *)map.mapping;
+        uint64_t fields[3];
+        memcpy(fields, header + 8, sizeof(fields));
+        // The sizes are checked as unsigned header fields before they are narrowed to int
+        if (memcmp(header, MAGIC, sizeof(MAGIC)) != 0 || fields[0] > INT_MAX || fields[1] > INT_MAX ||
+            fields[2] != (fields[0] + 2 + 63) / 64 ||
+            HEADER_BYTES + fields[2] * (fields[1] + 2) * sizeof(uint64_t) > map.mappingBytes)
+            throw runtime_error(path + " is not a grid bitmap");
+        map.width = fields[0];
+        map.height = fields[1];
+        map.wordsPerRow = fields[2];
+        map.bits = (uint64_t *)(header + HEADER_BYTES);
+        return map;
+    }
+};
+
+/*
+    Connected components of the free cells (8-connected, like the moves of the
+    search), so a query whose start and goal lie in different components can be
+    rejected without searching.
+
+    Labeling works on runs of free cells rather than single cells: the runs of a
+    row come straight out of the bitmap words, and a run joins every run of the row
+    above that it overlaps or touches diagonally. Rows are split into stripes that
+    are labeled in parallel with a union-find over their own runs; the stripes are
+    then joined along their boundary rows and every cell gets a compact label.
+
+    Afterwards the labels are kept up to date one cell at a time. A cell's
+    component is the union-find root of its label, so freeing a cell just joins
+    the components around it. Blocking a cell can only split its component if its
+    free neighbours are not connected around the cell itself; only then does a
+    search run, from each group of neighbours in turn step by step, and every
+    group that gets closed off before meeting the others gets a new label. That
+    search stops as soon as the groups meet, and otherwise costs the size of the
+    pieces that are cut off. Merged and emptied labels stay in the union-find
+    until their number outgrows the live components by a fraction of the map;
+    then every cell is relabeled with a compact label of its component, which
+    costs O(cells) once per that many updates.
+*/
+class ComponentMap
+{
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    int width = 0, height = 0;
+    vector<uint32_t> label;   // per cell, NONE for obstacles
+    vector<uint32_t> parent;  // union-find over labels
+    vector<uint32_t> size;    // cells per root label
+    uint32_t liveComponents = 0;
+
+    // Scratch for the split check after blocking a cell
+    vector<uint32_t> seenStamp;
+    vector<uint8_t> seenGroup;
+    uint32_t stamp = 0;
+
+    static constexpr int dx[8] = {-1, 1, 0, 0, -1, -1, 1, 1};
+    static constexpr int dy[8] = {0, 0, -1, 1, -1, 1, -1, 1};
+
+    // No path compression, so concurrent queries only read; union by size keeps trees shallow
+    uint32_t root(uint32_t id) const
+    {
+        while (parent[id] != id)
+            id = parent[id];
+        return id;
+    }
+
+    uint32_t unite(uint32_t a, uint32_t b)
+    {
+        a = root(a);
+        b = root(b);
+        if (a == b)
+            return a;
+        if (size[a] < size[b])
+            swap(a, b);
+        parent[b] = a;
+        size[a] += size[b];
+        liveComponents--;
+        return a;
+    }
+
+    uint32_t newLabel(uint32_t cells)
+    {
+        parent.push_back(parent.size());
+        size.push_back(cells);
+        liveComponents++;
+        return parent.size() - 1;
+    }
+
+    // Relabels every cell by its root so that only live components keep a label
+    void compact()
+    {
+        vector<uint32_t> compactLabel(parent.size(), NONE);
+        vector<uint32_t> compactSize;
+        for (uint32_t &id : label)
+        {
+            if (id == NONE)
+                continue;
+            uint32_t top = root(id);
+            if (compactLabel[top] == NONE)
+            {
+                compactLabel[top] = compactSize.size();
+                compactSize.push_back(size[top]);
+            }
+            id = compactLabel[top];
+        }
+        size = move(compactSize);
+        parent.resize(size.size());
+        iota(parent.begin(), parent.end(), 0);
+        liveComponents = size.size();
+    }
+
+    static int findRun(vector<int> &runParent, int run)
+    {
+        while (runParent[run] != run)
+            run = runParent[run] = runParent[runParent[run]];
+        return run;
+    }
+
+    static void uniteRuns(vector<int> &runParent, int a, int b)
+    {
+        a = findRun(runParent, a);
+        b = findRun(runParent, b);
+        if (a != b)
+            runParent[max(a, b)] = min(a, b);
+    }
+
+    // Joins the runs of two neighbouring rows that overlap or touch diagonally
+    static void joinRows(vector<int> &runParent, const vector<pair<int, int>> &upper, int upperFirst,
+                         const vector<pair<int, int>> &lower, int lowerFirst)
+    {
+        size_t i = 0, j = 0;
+        while (i < upper.size() && j < lower.size())
+        {
+            if (upper[i].first <= lower[j].second && lower[j].first <= upper[i].second)
+                uniteRuns(runParent, upperFirst + i, lowerFirst + j);
+            if (upper[i].second < lower[j].second)
+                i++;
+            else
+                j++;
+        }
+    }
+
+    bool isFree(int x, int y) const
+    {
+        return x >= 0 && x < width && y >= 0 && y < height && label[y * width + x] != NONE;
+    }
+
+    /*
+        After (x, y) was blocked: groups its free neighbours by adjacency to each
+        other, then grows a search from every group in turn. Groups whose searches
+        meet are merged; a group whose search runs out while others remain is a
+        separate piece and is relabeled.
+    */
+    void splitAround(int x, int y, uint32_t oldLabel)
+    {
+        // Group the free neighbours: two of them are adjacent if they touch each other
+        int ringGroup[8];
+        for (int i = 0; i < 8; i++)
+        {
+            ringGroup[i] = isFree(x + dx[i], y + dy[i]) ? i : -1;
+            for (int j = 0; j < i && ringGroup[i] != -1; j++)
+            {
+                if (ringGroup[j] == -1 || max(abs(dx[i] - dx[j]), abs(dy[i] - dy[j])) != 1)
+                    continue;
+                int from = ringGroup[j], to = ringGroup[i];
+                for (int k = 0; k < 8; k++)
+                    if (ringGroup[k] == from)
+                        ringGroup[k] = to;
+            }
+        }
+        vector<int> seeds; // one neighbour cell per group
+        for (int i = 0; i < 8; i++)
+            if (ringGroup[i] == i)
+                seeds.push_back((y + dy[i]) * width + x + dx[i]);
+        int groups = seeds.size();
+        if (groups <= 1)
+            return;
+
+        if (seenStamp.size() != label.size())
+        {
+            seenStamp.assign(label.size(), 0);
+            seenGroup.assign(label.size(), 0);
+            stamp = 0;
+        }
+        if (++stamp == 0)
+        {
+            fill(seenStamp.begin(), seenStamp.end(), 0);
+            stamp = 1;
+        }
+
+        // owner[] merges groups whose searches met; a retired group was cut off and relabeled
+        vector<vector<int>> queue(groups);
+        vector<size_t> head(groups, 0);
+        vector<int> owner(groups);
+        vector<char> retired(groups, 0);
+        for (int g = 0; g < groups; g++)
+        {
+            owner[g] = g;
+            queue[g].push_back(seeds[g]);
+            seenStamp[seeds[g]] = stamp;
+            seenGroup[seeds[g]] = g;
+        }
+        auto ownerOf = [&](int g)
+        {
+            while (owner[g] != g)
+                g = owner[g];
+            return g;
+        };
+        int remaining = groups;
+
+        while (remaining > 1)
+        {
+            for (int g = 0; g < groups; g++)
+            {
+                if (head[g] == queue[g].size() || retired[ownerOf(g)])
+                    continue;
+                int cell = queue[g][head[g]++];
+                int cx = cell % width, cy = cell / width;
+                for (int d = 0; d < 8; d++)
+                {
+                    if (!isFree(cx + dx[d], cy + dy[d]))
+                        continue;
+                    int next = (cy + dy[d]) * width + cx + dx[d];
+                    if (seenStamp[next] != stamp)
+                    {
+                        seenStamp[next] = stamp;
+                        seenGroup[next] = g;
+                        queue[g].push_back(next);
+                        continue;
+                    }
+                    int a = ownerOf(g), b = ownerOf(seenGroup[next]);
+                    if (a != b)
+                    {
+                        owner[max(a, b)] = min(a, b);
+                        remaining--;
+                    }
+                }
+            }
+
+            // A group whose searches have all run out is cut off from the others
+            for (int r = 0; r < groups && remaining > 1; r++)
+            {
+                if (owner[r] != r || retired[r])
+                    continue;
+                bool exhausted = true;
+                size_t cells = 0;
+                for (int g = 0; g < groups; g++)
+                    if (ownerOf(g) == r)
+                    {
+                        exhausted = exhausted && head[g] == queue[g].size();
+                        cells += queue[g].size();
+                    }
+                if (!exhausted)
+                    continue;
+
+                uint32_t piece = newLabel(cells);
+                size[root(oldLabel)] -= cells;
+                for (int g = 0; g < groups; g++)
+                    if (ownerOf(g) == r)
+                        for (int cell : queue[g])
+                            label[cell] = piece;
+                retired[r] = 1;
+                remaining--;
+            }
+        }
+    }
+
+public:
+    ComponentMap() {}
+
+    ComponentMap(const GridBitmap &grid, int nThreads = 0)
+        : width(grid.getWidth()), height(grid.getHeight()), label((size_t)width * height, NONE)
+    {
+        if (nThreads <= 0)
+            nThreads = max(1u, thread::hardware_concurrency());
+        int stripes = max(1, min(nThreads, height));
+
+        // Per stripe: the runs of each row and a union-find over them
+        struct Stripe
+        {
+            int firstRow, lastRow;
+            vector<vector<pair<int, int>>> rows;
+            vector<int> rowStart; // index of the first run of each row within the stripe
+            vector<int> runParent;
+        };
+        vector<Stripe> parts(stripes);
+        auto labelStripe = [&](int k)
+        {
+            Stripe &part = parts[k];
+            part.firstRow = (long long)height * k / stripes;
+            part.lastRow = (long long)height * (k + 1) / stripes;
+            part.rows.resize(part.lastRow - part.firstRow);
+            int runs = 0;
+            for (int y = part.firstRow; y < part.lastRow; y++)
+            {
+                vector<pair<int, int>> &row = part.rows[y - part.firstRow];
+                grid.freeRuns(y, row);
+                part.rowStart.push_back(runs);
+                for (size_t r = 0; r < row.size(); r++)
+                    part.runParent.push_back(runs + r);
+                if (y > part.firstRow)
+                    joinRows(part.runParent, part.rows[y - part.firstRow - 1], part.rowStart[y - part.firstRow - 1],
+                             row, runs);
+                runs += row.size();
+            }
+        };
+        vector<thread> threads;
+        for (int k = 1; k < stripes; k++)
+            threads.emplace_back(labelStripe, k);
+        labelStripe(0);
+        for (thread &t : threads)
+            t.join();
+
+        // Join the stripes into one run numbering and union-find
+        vector<int> offset(stripes + 1, 0);
+        for (int k = 0; k < stripes; k++)
+            offset[k + 1] = offset[k] + parts[k].runParent.size();
+        vector<int> runParent(offset[stripes]);
+        for (int k = 0; k < stripes; k++)
+            for (size_t r = 0; r < parts[k].runParent.size(); r++)
+                runParent[offset[k] + r] = offset[k] + parts[k].runParent[r];
+        for (int k = 1; k < stripes; k++)
+        {
+            const Stripe &above = parts[k - 1], &below = parts[k];
+            if (above.rows.empty() || below.rows.empty())
+                continue;
+            joinRows(runParent, above.rows.back(), offset[k - 1] + above.rowStart.back(), below.rows[0], offset[k]);
+        }
+
+        // Compact labels: every root run is numbered before the runs below it
+        vector<uint32_t> runLabel(runParent.size());
+        for (size_t r = 0; r < runParent.size(); r++)
+        {
+            int top = findRun(runParent, r);
+            if (top == (int)r)
+                runLabel[r] = newLabel(0);
+            else
+                runLabel[r] = runLabel[top];
+        }
+
+        auto fillStripe = [&](int k)
+        {
+            const Stripe &part = parts[k];
+            for (size_t i = 0; i < part.rows.size(); i++)
+            {
+                int y = part.firstRow + i;
+                for (size_t r = 0; r < part.rows[i].size(); r++)
+                {
+                    uint32_t id = runLabel[offset[k] + part.rowStart[i] + r];
+                    fill(label.begin() + (size_t)y * width + part.rows[i][r].first,
+                         label.begin() + (size_t)y * width + part.rows[i][r].second, id);
+                }
+            }
+        };
+        threads.clear();
+        for (int k = 1; k < stripes; k++)
+            threads.emplace_back(fillStripe, k);
+        fillStripe(0);
+        for (thread &t : threads)
+            t.join();
+        for (uint32_t id : label)
+            if (id != NONE)
+                size[id]++;
+    }
+
+    bool empty() const
+    {
+        return label.empty();
+    }
+
+    // Component of a cell, or UINT32_MAX for an obstacle; ids may change on update
+    uint32_t component(int x, int y) const
+    {
+        uint32_t id = label[y * width + x];
+        return id == NONE ? NONE : root(id);
+    }
+
+    bool connected(pair<int, int> a, pair<int, int> b) const
+    {
+        uint32_t ca = component(a.first, a.second);
+        return ca != NONE && ca == component(b.first, b.second);
+    }
+
+    uint32_t count() const
+    {
+        return liveComponents;
+    }
+
+    // Keeps the labels in step with a cell that was just freed or blocked
+    void update(int x, int y, bool free)
+    {
+        int cell = y * width + x;
+        if ((label[cell] != NONE) == free)
+            return;
+        if (free)
+        {
+            uint32_t joined = newLabel(1);
+            label[cell] = joined;
+            for (int d = 0; d < 8; d++)
+                if (isFree(x + dx[d], y + dy[d]))
+                    joined = unite(joined, label[(y + dy[d]) * width + x + dx[d]]);
+        }
+        else
+        {
+            uint32_t oldLabel = label[cell];
+            label[cell] = NONE;
+            uint32_t top = root(oldLabel);
+            if (--size[top] == 0)
+                liveComponents--;
+            else
+                splitAround(x, y, oldLabel);
+        }
+        if (parent.size() > 2 * (size_t)liveComponents + label.size() / 16 + 64)
+            compact();
+    }
+};
+
+// Open list entry; cells are identified by their index y * width + x
+struct OpenEntry
+{
+    double f_cost;
+    double g_cost;
+    int index;
+};
+
+class Compare
+{
+public:
+    bool operator()(const OpenEntry &below, const OpenEntry &above) const
+    {
+        return below.f_cost > above.f_cost;
+    };
+};
+
+/*
+    Per-query search state stored in flat arrays indexed by y * width + x.
+    The arrays are allocated once and reused: a cell's entries are only meaningful
+    when its stamp equals the current generation, so starting a new query is O(1)
+    instead of clearing the whole map.
+*/
+struct SearchScratch
+{
+    vector<double> g_cost;
+    vector<int> parent;
+    vector<uint32_t> stamp;  // generation in which g_cost/parent were written
+    vector<uint32_t> closed; // generation in which the cell was expanded
+    uint32_t generation = 0;
+    vector<OpenEntry> open;  // binary heap ordered by Compare
+    long long expanded = 0;
+    vector<uint32_t> goalLandmarks; // the goal's row of the landmark table (Heuristic::Landmarks)
+    unique_ptr<SearchScratch> backward; // search from the goal of SearchMode::Bidirectional, made on first use
+
+    void reset(int cells)
+    {
+        if ((int)stamp.size() != cells)
+        {
+            g_cost.assign(cells, DBL_MAX);
+            parent.assign(cells, -1);
+            stamp.assign(cells, 0);
+            closed.assign(cells, 0);
+            generation = 0;
+        }
+        if (++generation == 0)
+        {
+            fill(stamp.begin(), stamp.end(), 0);
+            fill(closed.begin(), closed.end(), 0);
+            generation = 1;
+        }
+        open.clear();
+        expanded = 0;
+    }
+
+    double g(int index) const
+    {
+        return stamp[index] == generation ? g_cost[index] : DBL_MAX;
+    }
+
+    void set(int index, double g, int from)
+    {
+        stamp[index] = generation;
+        g_cost[index] = g;
+        parent[index] = from;
+    }
+
+    void push(double f, double g, int index)
+    {
+        open.push_back({f, g, index});
+        push_heap(open.begin(), open.end(), Compare());
+    }
+
+    OpenEntry pop()
+    {
+        pop_heap(open.begin(), open.end(), Compare());
+        OpenEntry top = open.back();
+        open.pop_back();
+        return top;
+    }
+};
+
+enum class Heuristic
+{
+    Manhattan,
+    Euclidean,
+    Chebyshev, // exact on an open map when diagonal moves cost the same as straight ones
+    Landmarks  // ALT: triangle inequality over precomputed landmark distances (see buildLandmarks)
+};
+
+enum class LandmarkStrategy
+{
+    FarthestPoint, // each landmark is the cell farthest from the ones already chosen
+    Avoid          // Goldberg-Harrelson: grow into regions the current landmarks bound poorly
+};
+
+enum class SearchMode
+{
+    AStar,
+    JPS,    // Jump Point Search
+    JPSPlus,      // JPS with jump distances precomputed per cell and direction
+    Bidirectional // A* from both ends at once
+};
+
+/*
+    Distance and flow field towards one goal, for many agents sharing it.
+
+    A breadth-first search from the goal (every move costs 1, so the layers of the
+    BFS are the buckets of a bucket queue) gives every cell its distance to the
+    goal. A second pass stores, for every cell, the direction of its neighbour
+    closest to the goal. The distances live in an array with a one-cell border of
+    BLOCKED, so neither pass needs bounds checks, and the inner loop of the second
+    is a branch-free minimum over eight shifted rows that the compiler can
+    vectorize (-O3).
+    After that an agent's next step is one table lookup and its path costs
+    O(path length).
+*/
+class FlowField
+{
+private:
+    static constexpr uint32_t UNREACHED = UINT32_MAX;
+    static constexpr uint32_t BLOCKED = UINT32_MAX - 1; // obstacles and the border
+    static constexpr uint8_t NO_STEP = 8;
+
+    int width, height, stride;
+    int goalCell;
+    vector<uint32_t> dist; // (width + 2) * (height + 2), bordered
+    vector<uint8_t> step;  // per cell: index into dx/dy of the next move, NO_STEP at the goal or if unreachable
+
+    static constexpr int dx[8] = {-1, 1, 0, 0, -1, -1, 1, 1};
+    static constexpr int dy[8] = {0, 0, -1, 1, -1, 1, -1, 1};
+
+    int padded(int x, int y) const
+    {
+        return (y + 1) * stride + x + 1;
+    }
+
+    bool inside(pair<int, int> cell) const
+    {
+        return cell.first >= 0 && cell.first < width && cell.second >= 0 && cell.second < height;
+    }
+
+public:
+    FlowField(const GridBitmap &grid, pair<int, int> goal)
+        : width(grid.getWidth()), height(grid.getHeight()), stride(width + 2),
+          goalCell(goal.second * width + goal.first),
+          dist((size_t)(width + 2) * (height + 2), BLOCKED), step((size_t)width * height, NO_STEP)
+    {
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+                if (grid.passable(x, y))
+                    dist[padded(x, y)] = UNREACHED;
+        if (!inside(goal) || !grid.passable(goal.first, goal.second))
+            return;
+
+        int offset[8];
+        for (int k = 0; k < 8; k++)
+            offset[k] = dy[k] * stride + dx[k];
+
+        // The frontiers hold bordered indices
+        vector<int> current = {padded(goal.first, goal.second)}, next;
+        dist[current[0]] = 0;
+        for (uint32_t d = 1; !current.empty(); d++)
+        {
+            next.clear();
+            for (int cell : current)
+            {
+                for (int k = 0; k < 8; k++)
+                {
+                    if (dist[cell + offset[k]] == UNREACHED)
+                    {
+                        dist[cell + offset[k]] = d;
+                        next.push_back(cell + offset[k]);
+                    }
+                }
+            }
+            swap(current, next);
+        }
+
+        for (int y = 0; y < height; y++)
+        {
+            const uint32_t *row = &dist[padded(0, y)];
+            uint8_t *out = &step[y * width];
+            for (int x = 0; x < width; x++)
+            {
+                uint32_t best = row[x];
+                uint8_t bestStep = NO_STEP;
+                for (int k = 0; k < 8; k++)
+                {
+                    uint32_t candidate = row[x + offset[k]];
+                    bool closer = candidate < best;
+                    best = closer ? candidate : best;
+                    bestStep = closer ? k : bestStep;
+                }
+                // Blocked and unreachable cells keep NO_STEP
+                out[x] = row[x] >= BLOCKED ? NO_STEP : bestStep;
+            }
+        }
+    }
+
+    pair<int, int> goal() const
+    {
+        return {goalCell % width, goalCell / width};
+    }
+
+    // Distance to the goal, DBL_MAX if the goal cannot be reached or the cell is off the grid
+    double distance(pair<int, int> cell) const
+    {
+        if (!inside(cell))
+            return DBL_MAX;
+        uint32_t d = dist[padded(cell.first, cell.second)];
+        return d >= BLOCKED ? DBL_MAX : d;
+    }
+
+    // Next cell on a shortest path to the goal; the cell itself at the goal, if unreachable or off the grid
+    pair<int, int> nextStep(pair<int, int> cell) const
+    {
+        if (!inside(cell))
+            return cell;
+        uint8_t k = step[cell.second * width + cell.first];
+        if (k == NO_STEP)
+            return cell;
+        return {cell.first + dx[k], cell.second + dy[k]};
+    }
+
+    // Same format as GridSolver::findPath
+    pair<vector<pair<int, int>>, double> pathFrom(pair<int, int> cell) const
+    {
+        double cost = distance(cell);
+        if (cost == DBL_MAX)
+            return {vector<pair<int, int>>(), DBL_MAX};
+        vector<pair<int, int>> path;
+        path.reserve((size_t)cost + 1);
+        path.push_back(cell);
+        while (path.size() <= cost)
+            path.push_back(cell = nextStep(cell));
+        return {path, cost};
+    }
+};
+
+// Flow fields by goal cell, evicting the least recently used one when full
+class FlowFieldCache
+{
+private:
+    size_t capacity;
+    list<int> order; // most recently used first
+    unordered_map<int, pair<shared_ptr<const FlowField>, list<int>::iterator>> fields;
+
+public:
+    FlowFieldCache(size_t capacity) : capacity(max<size_t>(capacity, 1)) {}
+
+    shared_ptr<const FlowField> get(const GridBitmap &grid, pair<int, int> goal)
+    {
+        int key = goal.second * grid.getWidth() + goal.first;
+        auto found = fields.find(key);
+        if (found != fields.end())
+        {
+            order.splice(order.begin(), order, found->second.second);
+            return found->second.first;
+        }
+        if (fields.size() == capacity)
+        {
+            fields.erase(order.back());
+            order.pop_back();
+        }
+        order.push_front(key);
+        auto field = make_shared<const FlowField>(grid, goal);
+        fields[key] = {field, order.begin()};
+        return field;
+    }
+
+    void clear()
+    {
+        fields.clear();
+        order.clear();
+    }
+
+    size_t size() const
+    {
+        return fields.size();
+    }
+};
+
+// One start/goal pair of a batch
+struct PathQuery
+{
+    pair<int, int> start, goal;
+};
+
+/*
+    Results of a batch with all paths back to back in one arena: path i is
+    cells[offsets[i]] .. cells[offsets[i + 1] - 1], and is empty with cost
+    DBL_MAX when there is no path.
+*/
+struct BatchPaths
+{
+    vector<pair<int, int>> cells;
+    vector<size_t> offsets;
+    vector<double> costs;
+    long long expanded = 0;
+    double seconds = 0;
+
+    size_t size() const
+    {
+        return costs.size();
+    }
+
+    const pair<int, int> *path(size_t i) const
+    {
+        return cells.data() + offsets[i];
+    }
+
+    size_t length(size_t i) const
+    {
+        return offsets[i + 1] - offsets[i];
+    }
+
+    double queriesPerSecond() const
+    {
+        return seconds > 0 ? size() / seconds : 0;
+    }
+};
+
+/*
+    Persistent worker threads for GridSolver::solveBatch. Each worker keeps its
+    SearchScratch for the pool's lifetime, so a batch neither starts threads nor
+    allocates per-cell arrays once the first batch has run (the scratch is only
+    reallocated when the number of cells changes). Worker 0 is the calling thread.
+
+    A batch deals its queries in chunks to per-worker deques; a worker takes chunks
+    from the back of its own deque and, once it is empty, steals from the front of
+    the others, so long queries on one worker do not leave the rest idle.
+*/
+class SearchPool
+{
+private:
+    struct Worker
+    {
+        mutex lock;
+        deque<pair<int, int>> chunks; // [first, last) query ranges
+        SearchScratch search;
+    };
+
+    vector<unique_ptr<Worker>> workers;
+    vector<thread> threads; // threads[i] runs worker i + 1
+    mutex lock;
+    condition_variable wake, done;
+    uint64_t round = 0;   // bumped once per batch
+    int participants = 0; // workers taking part in the current batch
+    int running = 0;      // helper threads still working on it
+    bool stopping = false;
+    const function<void(int, SearchScratch &, int)> *task = nullptr;
+
+    bool takeChunk(int id, pair<int, int> &range)
+    {
+        for (int i = 0; i < participants; i++)
+        {
+            Worker &worker = *workers[(id + i) % participants];
+            lock_guard<mutex> guard(worker.lock);
+            if (worker.chunks.empty())
+                continue;
+            if (i == 0)
+            {
+                range = worker.chunks.back();
+                worker.chunks.pop_back();
+            }
+            else
+            {
+                range = worker.chunks.front();
+                worker.chunks.pop_front();
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void work(int id)
+    {
+        pair<int, int> range;
+        while (takeChunk(id, range))
+            for (int q = range.first; q < range.second; q++)
+                (*task)(id, workers[id]->search, q);
+    }
+
+    void threadLoop(int id)
+    {
+        uint64_t seen = 0;
+        unique_lock<mutex> guard(lock);
+        while (true)
+        {
+            wake.wait(guard, [&]
+                      { return stopping || round != seen; });
+            if (stopping)
+                return;
+            seen = round;
+            if (id >= participants)
+                continue;
+            guard.unlock();
+            work(id);
+            guard.lock();
+            if (--running == 0)
+                done.notify_one();
+        }
+    }
+
+public:
+    SearchPool() = default;
+    SearchPool(const SearchPool &) = delete;
+    SearchPool &operator=(const SearchPool &) = delete;
+
+    ~SearchPool()
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (thread &t : threads)
+            t.join();
+    }
+
+    /*
+        Calls task(worker, scratch, q) for every q in [0, n) on nThreads workers
+        and returns once all of them are done. Workers are added as needed and
+        never removed.
+    */
+    void run(int n, int nThreads, const function<void(int, SearchScratch &, int)> &batchTask)
+    {
+        while ((int)workers.size() < nThreads)
+        {
+            workers.push_back(make_unique<Worker>());
+            if (workers.size() > 1)
+                threads.emplace_back(&SearchPool::threadLoop, this, (int)workers.size() - 1);
+        }
+        int chunk = max(1, min(64, n / (nThreads * 8)));
+        for (int first = 0, k = 0; first < n; first += chunk, k++)
+            workers[k % nThreads]->chunks.push_back({first, min(n, first + chunk)});
+
+        {
+            lock_guard<mutex> guard(lock);
+            task = &batchTask;
+            participants = nThreads;
+            running = nThreads - 1;
+            round++;
+        }
+        wake.notify_all();
+        work(0);
+        unique_lock<mutex> guard(lock);
+        done.wait(guard, [&]
+                  { return running == 0; });
+        task = nullptr;
+    }
+};
+
+class GridSolver
+{
+private:
+    int width, height;
+    GridBitmap grid;
+    SearchScratch scratch;
+    unique_ptr<SearchPool> pool; // made by the first solveBatch
+    FlowFieldCache flowFields{16};
+    ComponentMap components; // empty until buildComponents
+
+    vector<pair<int, int>> directions = {
+        {-1, 0}, {1, 0}, {0, -1}, {0, 1}, {-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
+
+    /*
+        JPS+ table: for every cell and every direction (in the order of `directions`),
+        k > 0 means the next jump point is k steps away, k <= 0 means the cell can
+        move -k steps before running into an obstacle or the border without meeting
+        a jump point. Built on the first JPS+ query.
+    */
+    vector<array<int, 8>> jumpDistances;
+
+    /*
+        ALT landmark tables, cell-major (the K distances of one cell are adjacent,
+        which is the access pattern of the heuristic). Distances are stored in 16 bits
+        when every finite distance fits, otherwise in 32 bits; the maximum value of
+        the type marks cells the landmark cannot reach.
+    */
+    int landmarkCount = 0;
+    vector<int> landmarkCells;
+    vector<uint16_t> landmarkDist16;
+    vector<uint32_t> landmarkDist32;
+
+    static constexpr uint32_t UNREACHABLE = UINT32_MAX;
+
+    uint32_t landmarkDistance(int cell, int k) const
+    {
+        if (!landmarkDist32.empty())
+            return landmarkDist32[(size_t)cell * landmarkCount + k];
+        uint16_t d = landmarkDist16[(size_t)cell * landmarkCount + k];
+        return d == UINT16_MAX ? UNREACHABLE : d;
+    }
+
+    // BFS distances from one cell (every move costs 1, so this is Dijkstra)
+    vector<uint32_t> distancesFrom(int source, vector<int> *parent = nullptr)
+    {
+        vector<uint32_t> dist(width * height, UNREACHABLE);
+        if (parent)
+            parent->assign(width * height, -1);
+        vector<int> queue;
+        dist[source] = 0;
+        queue.push_back(source);
+        for (size_t head = 0; head < queue.size(); head++)
+        {
+            int cell = queue[head];
+            int x = cell % width, y = cell / width;
+            unsigned passable = grid.neighbourMask(x, y);
+            for (int d = 0; d < 8; d++)
+            {
+                if (!(passable >> d & 1))
+                    continue;
+                int next = (y + directions[d].second) * width + x + directions[d].first;
+                if (dist[next] == UNREACHABLE)
+                {
+                    dist[next] = dist[cell] + 1;
+                    if (parent)
+                        (*parent)[next] = cell;
+                    queue.push_back(next);
+                }
+            }
+        }
+        return dist;
+    }
+
+    int farthestCell(const vector<uint32_t> &dist, const vector<int> &freeCells)
+    {
+        int farthest = freeCells[0];
+        for (int cell : freeCells)
+            if (dist[cell] != UNREACHABLE && (dist[farthest] == UNREACHABLE || dist[cell] > dist[farthest]))
+                farthest = cell;
+        return farthest;
+    }
+
+    /*
+        Avoid strategy: in a shortest-path tree from `root`, weight each cell by how
+        much the current landmarks underestimate its distance to the root, sum the
+        weights per subtree (zero for subtrees that already hold a landmark) and walk
+        down into the heaviest subtree until a leaf; that leaf is the new landmark.
+    */
+    int avoidCell(const vector<vector<uint32_t>> &tables, const vector<int> &freeCells, int root)
+    {
+        vector<int> parent;
+        vector<uint32_t> dist = distancesFrom(root, &parent);
+        vector<int> order; // BFS tree cells, parents before children
+        for (int cell : freeCells)
+            if (dist[cell] != UNREACHABLE)
+                order.push_back(cell);
+        sort(order.begin(), order.end(), [&](int a, int b)
+             { return dist[a] < dist[b]; });
+
+        vector<double> size(width * height, 0);
+        vector<char> hasLandmark(width * height, 0);
+        for (int landmark : landmarkCells)
+            hasLandmark[landmark] = 1;
+        for (int i = order.size() - 1; i >= 0; i--)
+        {
+            int cell = order[i];
+            double bound = 0;
+            for (const auto &table : tables)
+                bound = max(bound, fabs((double)table[root] - (double)table[cell]));
+            size[cell] = hasLandmark[cell] ? 0 : size[cell] + dist[cell] - bound;
+            if (parent[cell] != -1)
+            {
+                hasLandmark[parent[cell]] |= hasLandmark[cell];
+                size[parent[cell]] += size[cell];
+            }
+        }
+
+        unordered_map<int, vector<int>> children;
+        for (int cell : order)
+            if (parent[cell] != -1)
+                children[parent[cell]].push_back(cell);
+
+        int chosen = root;
+        while (true)
+        {
+            int next = -1;
+            for (int child : children[chosen])
+                if (size[child] > 0 && (next == -1 || size[child] > size[next]))
+                    next = child;
+            if (next == -1)
+                return chosen;
+            chosen = next;
+        }
+    }
+
+    double calculateHCostLandmarks(const vector<uint32_t> &goalLandmarkDist, int x, int y, int goalX, int goalY)
+    {
+        double best = calculateHCostChebyshev(x, y, goalX, goalY);
+        int cell = y * width + x;
+        for (int k = 0; k < landmarkCount; k++)
+        {
+            uint32_t toCell = landmarkDistance(cell, k), toGoal = goalLandmarkDist[k];
+            if (toCell == UNREACHABLE && toGoal == UNREACHABLE)
+                continue;
+            if (toCell == UNREACHABLE || toGoal == UNREACHABLE)
+                return DBL_MAX; // different components: the goal cannot be reached from here
+            best = max(best, fabs((double)toCell - (double)toGoal));
+        }
+        return best;
+    }
+
+    double calculateHCostEuclidean(int x, int y, int goalX, int goalY)
+    {
+        double dx = x - goalX;
+        double dy = y - goalY;
+        return sqrt(dx * dx + dy * dy);
+    }
+
+    double calculateHCostManhattan(int x, int y, int goalX, int goalY)
+    {
+        double dx = abs(x - goalX) * 1.0;
+        double dy = abs(y - goalY) * 1.0;
+        return dx + dy;
+    }
+
+    double calculateHCostChebyshev(int x, int y, int goalX, int goalY)
+    {
+        return max(abs(x - goalX), abs(y - goalY)) * 1.0;
+    }
+
+    double calculateHCost(const SearchScratch &search, Heuristic heuristic, int x, int y, int goalX, int goalY)
+    {
+        switch (heuristic)
+        {
+        case Heuristic::Manhattan:
+            return calculateHCostManhattan(x, y, goalX, goalY);
+        case Heuristic::Euclidean:
+            return calculateHCostEuclidean(x, y, goalX, goalY);
+        case Heuristic::Landmarks:
+            return calculateHCostLandmarks(search.goalLandmarks, x, y, goalX, goalY);
+        default:
+            return calculateHCostChebyshev(x, y, goalX, goalY);
+        }
+    }
+
+    bool isValid(int x, int y)
+    {
+        return x >= 0 && x < width && y >= 0 && y < height && grid.passable(x, y);
+    }
+
+    static int directionIndex(int dx, int dy)
+    {
+        static const int index[3][3] = {{4, 0, 5}, {2, -1, 3}, {6, 1, 7}};
+        return index[dx + 1][dy + 1];
+    }
+
+    vector<pair<int, int>> tracePath(const SearchScratch &search, int index)
+    {
+        vector<pair<int, int>> path;
+        for (; index != -1; index = search.parent[index])
+        {
+            path.push_back({index % width, index / width});
+        }
+        reverse(path.begin(), path.end());
+        return path;
+    }
+
+    // Jump point paths only hold the turning points; fill in the straight/diagonal runs
+    vector<pair<int, int>> expandJumps(const vector<pair<int, int>> &jumps)
+    {
+        vector<pair<int, int>> path;
+        for (size_t i = 0; i < jumps.size(); i++)
+        {
+            if (i == 0)
+            {
+                path.push_back(jumps[0]);
+                continue;
+            }
+            int x = jumps[i - 1].first, y = jumps[i - 1].second;
+            int dx = (jumps[i].first > x) - (jumps[i].first < x);
+            int dy = (jumps[i].second > y) - (jumps[i].second < y);
+            while (x != jumps[i].first || y != jumps[i].second)
+            {
+                x += dx;
+                y += dy;
+                path.push_back({x, y});
+            }
+        }
+        return path;
+    }
+
+    /*
+        Directions worth following from (x, y) when it was reached moving (dx, dy):
+        the natural neighbours plus the forced ones next to an obstacle. Every other
+        neighbour can be reached from the parent at no greater cost without passing
+        through (x, y). The start cell (dx = dy = 0) keeps all 8 directions.
+    */
+    int prunedDirections(int x, int y, int dx, int dy, pair<int, int> out[8])
+    {
+        int count = 0;
+        if (dx == 0 && dy == 0)
+        {
+            for (const auto &dir : directions)
+                out[count++] = dir;
+            return count;
+        }
+
+        if (dx != 0 && dy != 0)
+        {
+            out[count++] = {dx, 0};
+            out[count++] = {0, dy};
+            out[count++] = {dx, dy};
+            if (!isValid(x - dx, y) && isValid(x - dx, y + dy))
+                out[count++] = {-dx, dy};
+            if (!isValid(x, y - dy) && isValid(x + dx, y - dy))
+                out[count++] = {dx, -dy};
+        }
+        else if (dx != 0)
+        {
+            out[count++] = {dx, 0};
+            if (!isValid(x, y + 1) && isValid(x + dx, y + 1))
+                out[count++] = {dx, 1};
+            if (!isValid(x, y - 1) && isValid(x + dx, y - 1))
+                out[count++] = {dx, -1};
+        }
+        else
+        {
+            out[count++] = {0, dy};
+            if (!isValid(x + 1, y) && isValid(x + 1, y + dy))
+                out[count++] = {1, dy};
+            if (!isValid(x - 1, y) && isValid(x - 1, y + dy))
+                out[count++] = {-1, dy};
+        }
+        return count;
+    }
+
+    // Whether a valid cell reached moving (dx, dy) has a forced neighbour
+    bool hasForcedNeighbour(int x, int y, int dx, int dy)
+    {
+        if (dx != 0 && dy != 0)
+            return (!isValid(x - dx, y) && isValid(x - dx, y + dy)) ||
+                   (!isValid(x, y - dy) && isValid(x + dx, y - dy));
+        if (dx != 0)
+            return (!isValid(x, y + 1) && isValid(x + dx, y + 1)) ||
+                   (!isValid(x, y - 1) && isValid(x + dx, y - 1));
+        return (!isValid(x + 1, y) && isValid(x + 1, y + dy)) ||
+               (!isValid(x - 1, y) && isValid(x - 1, y + dy));
+    }
+
+    // Next jump point from (x, y) in direction (dx, dy), or -1 if the run hits an obstacle
+    int jump(int x, int y, int dx, int dy, int goalX, int goalY)
+    {
+        while (true)
+        {
+            x += dx;
+            y += dy;
+            if (!isValid(x, y))
+                return -1;
+            if ((x == goalX && y == goalY) || hasForcedNeighbour(x, y, dx, dy))
+                return y * width + x;
+            if (dx != 0 && dy != 0 &&
+                (jump(x, y, dx, 0, goalX, goalY) != -1 || jump(x, y, 0, dy, goalX, goalY) != -1))
+                return y * width + x;
+        }
+    }
+
+    void buildJumpDistances()
+    {
+        jumpDistances.assign(width * height, array<int, 8>());
+
+        // Each cell's value follows from the next cell in the same direction, so
+        // every direction is swept starting from the side it moves towards
+        auto sweep = [&](int d)
+        {
+            int dx = directions[d].first, dy = directions[d].second;
+            for (int yi = 0; yi < height; yi++)
+            {
+                int y = dy > 0 ? height - 1 - yi : yi;
+                for (int xi = 0; xi < width; xi++)
+                {
+                    int x = dx > 0 ? width - 1 - xi : xi;
+                    int &dist = jumpDistances[y * width + x][d];
+                    int nx = x + dx, ny = y + dy;
+                    if (!isValid(x, y) || !isValid(nx, ny))
+                    {
+                        dist = 0;
+                        continue;
+                    }
+                    const array<int, 8> &next = jumpDistances[ny * width + nx];
+                    bool jumpPoint = hasForcedNeighbour(nx, ny, dx, dy);
+                    if (dx != 0 && dy != 0)
+                        jumpPoint = jumpPoint || next[directionIndex(dx, 0)] > 0 || next[directionIndex(0, dy)] > 0;
+                    if (jumpPoint)
+                        dist = 1;
+                    else
+                        dist = next[d] > 0 ? next[d] + 1 : next[d] - 1;
+                }
+            }
+        };
+
+        // Diagonal distances depend on the straight ones
+        for (int d = 0; d < 4; d++)
+            sweep(d);
+        for (int d = 4; d < 8; d++)
+            sweep(d);
+    }
+
+    // Successor of (x, y) in direction (dx, dy) using the JPS+ table, or -1
+    int jumpPlus(int x, int y, int dx, int dy, int goalX, int goalY)
+    {
+        int dist = jumpDistances[y * width + x][directionIndex(dx, dy)];
+        int reach = abs(dist);
+        int toGoalX = goalX - x, toGoalY = goalY - y;
+
+        if (dx == 0 || dy == 0)
+        {
+            // Goal on this ray before the jump point or the wall
+            int steps = dx != 0 ? toGoalX * dx : toGoalY * dy;
+            bool onRay = dx != 0 ? toGoalY == 0 : toGoalX == 0;
+            if (onRay && steps > 0 && steps <= reach)
+                return goalY * width + goalX;
+        }
+        else if (toGoalX * dx > 0 && toGoalY * dy > 0)
+        {
+            // Stop where the diagonal meets the goal's row or column, from where a straight run may reach it
+            int steps = min(abs(toGoalX), abs(toGoalY));
+            if (steps <= reach)
+                return (y + steps * dy) * width + (x + steps * dx);
+        }
+        if (dist > 0)
+            return (y + dist * dy) * width + (x + dist * dx);
+        return -1;
+    }
+
+    pair<vector<pair<int, int>>, double> findPathJump(
+        SearchScratch &search, pair<int, int> start,
+        pair<int, int> goal, Heuristic heuristic, bool usePlus)
+    {
+        search.reset(width * height);
+
+        int startIndex = start.second * width + start.first;
+        int goalIndex = goal.second * width + goal.first;
+        search.set(startIndex, 0, -1);
+        search.push(calculateHCost(search, heuristic, start.first, start.second, goal.first, goal.second), 0, startIndex);
+
+        pair<int, int> dirs[8];
+        while (!search.open.empty())
+        {
+            OpenEntry current = search.pop();
+            if (current.g_cost > search.g(current.index) || search.closed[current.index] == search.generation)
+                continue;
+            search.closed[current.index] = search.generation;
+            search.expanded++;
+
+            if (current.index == goalIndex)
+            {
+                return {expandJumps(tracePath(search, goalIndex)), current.g_cost};
+            }
+
+            int x = current.index % width;
+            int y = current.index / width;
+            int dx = 0, dy = 0;
+            if (search.parent[current.index] != -1)
+            {
+                int px = search.parent[current.index] % width;
+                int py = search.parent[current.index] / width;
+                dx = (x > px) - (x < px);
+                dy = (y > py) - (y < py);
+            }
+
+            int count = prunedDirections(x, y, dx, dy, dirs);
+            for (int i = 0; i < count; i++)
+            {
+                int next = usePlus ? jumpPlus(x, y, dirs[i].first, dirs[i].second, goal.first, goal.second)
+                                   : jump(x, y, dirs[i].first, dirs[i].second, goal.first, goal.second);
+                if (next == -1)
+                    continue;
+
+                int newX = next % width;
+                int newY = next / width;
+                // Every move costs 1, so a straight or diagonal run costs its Chebyshev length
+                double tentative_g = current.g_cost + max(abs(newX - x), abs(newY - y));
+                if (tentative_g < search.g(next))
+                {
+                    search.set(next, tentative_g, current.index);
+                    search.closed[next] = 0;
+                    search.push(tentative_g + calculateHCost(search, heuristic, newX, newY, goal.first, goal.second), tentative_g, next);
+                }
+            }
+        }
+
+        return {vector<pair<int, int>>(), DBL_MAX};
+    }
+
+    /*
+        Bidirectional A* (front-to-end): one search from the start towards the goal
+        and one from the goal towards the start, each on its own scratch space and
+        each expanding the cell it would expand as a plain A*. The side with the
+        smaller open list moves next. Every time a cell is reached that the other
+        side has a cost for, mu (the best start-goal path seen so far) is updated.
+        With a consistent heuristic (Chebyshev, Landmarks) no cheaper path exists
+        once mu is no more than the larger of the two smallest f values, so the
+        search stops there and the result is optimal.
+    */
+    pair<vector<pair<int, int>>, double> findPathBidirectional(
+        SearchScratch &forward, pair<int, int> start,
+        pair<int, int> goal, Heuristic heuristic)
+    {
+        if (!forward.backward)
+            forward.backward = make_unique<SearchScratch>();
+        SearchScratch &backward = *forward.backward;
+        forward.reset(width * height);
+        backward.reset(width * height);
+
+        // The backward search heads for the start, so it gets the start's landmark row
+        if (heuristic == Heuristic::Landmarks)
+        {
+            int startCell = start.second * width + start.first;
+            backward.goalLandmarks.resize(landmarkCount);
+            for (int k = 0; k < landmarkCount; k++)
+                backward.goalLandmarks[k] = landmarkDistance(startCell, k);
+        }
+
+        int startIndex = start.second * width + start.first;
+        int goalIndex = goal.second * width + goal.first;
+        forward.set(startIndex, 0, -1);
+        forward.push(calculateHCost(forward, heuristic, start.first, start.second, goal.first, goal.second), 0, startIndex);
+        backward.set(goalIndex, 0, -1);
+        backward.push(calculateHCost(backward, heuristic, goal.first, goal.second, start.first, start.second), 0, goalIndex);
+
+        double best = startIndex == goalIndex ? 0 : DBL_MAX;
+        int meeting = startIndex == goalIndex ? startIndex : -1;
+
+        // Drops superseded and already expanded entries from the top of a heap
+        auto settle = [](SearchScratch &search)
+        {
+            while (!search.open.empty() && (search.open.front().g_cost > search.g(search.open.front().index) ||
+                                            search.closed[search.open.front().index] == search.generation))
+                search.pop();
+            return !search.open.empty();
+        };
+
+        while (settle(forward) && settle(backward))
+        {
+            if (best <= max(forward.open.front().f_cost, backward.open.front().f_cost))
+                break;
+
+            bool forwardSide = forward.open.size() <= backward.open.size();
+            SearchScratch &search = forwardSide ? forward : backward;
+            SearchScratch &other = forwardSide ? backward : forward;
+            pair<int, int> target = forwardSide ? goal : start;
+
+            OpenEntry current = search.pop();
+            search.closed[current.index] = search.generation;
+            search.expanded++;
+
+            int x = current.index % width;
+            int y = current.index / width;
+            unsigned passable = grid.neighbourMask(x, y);
+            for (int d = 0; d < 8; d++)
+            {
+                if (!(passable >> d & 1))
+                    continue;
+                int newX = x + directions[d].first;
+                int newY = y + directions[d].second;
+                int neighbor = newY * width + newX;
+                double tentative_g = current.g_cost + 1.0;
+                if (tentative_g < search.g(neighbor))
+                {
+                    search.set(neighbor, tentative_g, current.index);
+                    search.closed[neighbor] = 0;
+                    search.push(tentative_g + calculateHCost(search, heuristic, newX, newY, target.first, target.second), tentative_g, neighbor);
+                    if (other.g(neighbor) != DBL_MAX && tentative_g + other.g(neighbor) < best)
+                    {
+                        best = tentative_g + other.g(neighbor);
+                        meeting = neighbor;
+                    }
+                }
+            }
+        }
+
+        long long expanded = forward.expanded + backward.expanded;
+        forward.expanded = expanded;
+        if (meeting == -1)
+            return {vector<pair<int, int>>(), DBL_MAX};
+
+        // Start to meeting cell from the forward tree, then on to the goal along the backward tree
+        vector<pair<int, int>> path = tracePath(forward, meeting);
+        for (int cell = backward.parent[meeting]; cell != -1; cell = backward.parent[cell])
+            path.push_back({cell % width, cell / width});
+        return {path, best};
+    }
+
+    /*
+        One query on the given scratch space. Only reads the map and the
+        precomputed tables, so queries on different scratch spaces can run in
+        parallel (the JPS+ table must already be built).
+    */
+    pair<vector<pair<int, int>>, double> findPath(
+        SearchScratch &search, pair<int, int> start,
+        pair<int, int> goal, Heuristic heuristic, SearchMode mode)
+    {
+        // Check if start and end are valid
+        if (!isValid(start.first, start.second) || !isValid(goal.first, goal.second))
+        {
+            search.expanded = 0;
+            return {vector<pair<int, int>>(), DBL_MAX};
+        }
+        if (!components.empty() && !components.connected(start, goal))
+        {
+            search.expanded = 0;
+            return {vector<pair<int, int>>(), DBL_MAX};
+        }
+
+        if (heuristic == Heuristic::Landmarks)
+        {
+            int goalCell = goal.second * width + goal.first;
+            search.goalLandmarks.resize(landmarkCount);
+            for (int k = 0; k < landmarkCount; k++)
+                search.goalLandmarks[k] = landmarkDistance(goalCell, k);
+        }
+
+        if (mode == SearchMode::Bidirectional)
+        {
+            return findPathBidirectional(search, start, goal, heuristic);
+        }
+        if (mode != SearchMode::AStar)
+        {
+            return findPathJump(search, start, goal, heuristic, mode == SearchMode::JPSPlus);
+        }
+
+        search.reset(width * height);
+        int startIndex = start.second * width + start.first;
+        int goalIndex = goal.second * width + goal.first;
+        search.set(startIndex, 0, -1);
+        search.push(calculateHCost(search, heuristic, start.first, start.second, goal.first, goal.second), 0, startIndex);
+
+        while (!search.open.empty())
+        {
+            OpenEntry current = search.pop();
+
+            // Skip entries superseded by a cheaper path and cells already expanded with this cost
+            if (current.g_cost > search.g(current.index) || search.closed[current.index] == search.generation)
+                continue;
+            search.closed[current.index] = search.generation;
+            search.expanded++;
+
+            if (current.index == goalIndex)
+            {
+                return {tracePath(search, goalIndex), current.g_cost};
+            }
+
+            int x = current.index % width;
+            int y = current.index / width;
+            unsigned passable = grid.neighbourMask(x, y);
+            for (int d = 0; d < 8; d++)
+            {
+                if (!(passable >> d & 1))
+                    continue;
+                int newX = x + directions[d].first;
+                int newY = y + directions[d].second;
+
+                // double movementCost = (dir.first != 0 && dir.second != 0) ? sqrt(2.0) : 1.0;
+                double movementCost = 1.0; // Considering diagonal movement is treated same as vertical or horizontal movement
+                double tentative_g = current.g_cost + movementCost;
+
+                int neighbor = newY * width + newX;
+                if (tentative_g < search.g(neighbor))
+                {
+                    // A cheaper path reopens a closed cell (the heuristics are not consistent)
+                    search.set(neighbor, tentative_g, current.index);
+                    search.closed[neighbor] = 0;
+                    search.push(tentative_g + calculateHCost(search, heuristic, newX, newY, goal.first, goal.second), tentative_g, neighbor);
+                }
+            }
+        }
+
+        return {vector<pair<int, int>>(), DBL_MAX};
+    }
+
+public:
+    GridSolver(int w, int h, const vector<vector<int>> &obstacles)
+        : width(w), height(h), grid(w, h, obstacles) {}
+
+    GridSolver(GridBitmap map)
+        : width(map.getWidth()), height(map.getHeight()), grid(move(map)) {}
+
+    const GridBitmap &map() const
+    {
+        return grid;
+    }
+
+    bool passable(int x, int y)
+    {
+        return isValid(x, y);
+    }
+
+    /*
+        Changes one cell. The JPS+ table and the cached flow fields are dropped and
+        rebuilt when next needed; component labels are updated in place. Landmark
+        distances stay admissible while cells only get blocked (distances can only
+        grow); freeing a cell drops them.
+    */
+    void setCell(int x, int y, bool free)
+    {
+        if (x < 0 || x >= width || y < 0 || y >= height || grid.passable(x, y) == free)
+            return;
+        grid.set(x, y, free);
+        jumpDistances.clear();
+        flowFields.clear();
+        if (!components.empty())
+            components.update(x, y, free);
+        if (free && landmarkCount > 0)
+        {
+            landmarkCount = 0;
+            landmarkCells.clear();
+            landmarkDist16.clear();
+            landmarkDist32.clear();
+        }
+    }
+
+    /*
+        Builds the JPS+ jump distance table now instead of on the first JPS+
+        query (or batch). setCell drops it again.
+    */
+    void buildJumpTable()
+    {
+        buildJumpDistances();
+    }
+
+    /*
+        Labels the connected components so that findPath rejects a goal in another
+        component at once; setCell keeps the labels up to date from then on.
+    */
+    void buildComponents(int nThreads = 0)
+    {
+        components = ComponentMap(grid, nThreads);
+    }
+
+    const ComponentMap &componentMap() const
+    {
+        return components;
+    }
+
+    /*
+        Distance and flow field towards goal, from the cache when the goal was used
+        recently. The field stays valid for the caller after it is evicted. A goal
+        off the grid gets no field (nullptr) and is not cached.
+    */
+    shared_ptr<const FlowField> flowField(pair<int, int> goal)
+    {
+        if (goal.first < 0 || goal.first >= width || goal.second < 0 || goal.second >= height)
+            return nullptr;
+        return flowFields.get(grid, goal);
+    }
+
+    // Number of cells expanded by the last findPath call
+    long long lastExpansions() const
+    {
+        return scratch.expanded;
+    }
+
+    /*
+        Picks `count` landmarks and stores their distance to every cell for
+        Heuristic::Landmarks. Memory is count * cells * 2 (or 4) bytes. Free cells
+        no landmark reaches are preferred as the next landmark, so every component
+        gets one. Without landmarks the heuristic is plain Chebyshev.
+    */
+    void buildLandmarks(int count, LandmarkStrategy strategy = LandmarkStrategy::FarthestPoint, unsigned seed = 1)
+    {
+        int cells = width * height;
+        vector<vector<uint32_t>> tables;
+        landmarkCells.clear();
+        landmarkCount = 0;
+        landmarkDist16.clear();
+        landmarkDist32.clear();
+
+        vector<int> freeCells;
+        for (int cell = 0; cell < cells; cell++)
+            if (grid.passable(cell % width, cell / width))
+                freeCells.push_back(cell);
+        if (freeCells.empty())
+            return;
+        mt19937 rng(seed);
+
+        // Distance from every cell to its nearest landmark so far
+        vector<uint32_t> nearest(cells, UNREACHABLE);
+        for (int k = 0; k < count; k++)
+        {
+            // A component no landmark reaches gets one first
+            int chosen = -1;
+            if (k > 0)
+            {
+                for (int cell : freeCells)
+                    if (nearest[cell] == UNREACHABLE)
+                    {
+                        chosen = cell;
+                        break;
+                    }
+            }
+            if (chosen == -1)
+            {
+                if (k == 0)
+                    chosen = farthestCell(distancesFrom(freeCells[rng() % freeCells.size()]), freeCells);
+                else if (strategy == LandmarkStrategy::FarthestPoint)
+                    chosen = farthestCell(nearest, freeCells);
+                else
+                    chosen = avoidCell(tables, freeCells, freeCells[rng() % freeCells.size()]);
+            }
+            if (find(landmarkCells.begin(), landmarkCells.end(), chosen) != landmarkCells.end())
+                break;
+
+            landmarkCells.push_back(chosen);
+            tables.push_back(distancesFrom(chosen));
+            for (int cell = 0; cell < cells; cell++)
+                nearest[cell] = min(nearest[cell], tables.back()[cell]);
+        }
+
+        landmarkCount = tables.size();
+        uint32_t maxDistance = 0;
+        for (const auto &table : tables)
+            for (uint32_t d : table)
+                if (d != UNREACHABLE)
+                    maxDistance = max(maxDistance, d);
+
+        if (maxDistance < UINT16_MAX)
+        {
+            landmarkDist16.assign((size_t)cells * landmarkCount, UINT16_MAX);
+            for (int k = 0; k < landmarkCount; k++)
+                for (int cell = 0; cell < cells; cell++)
+                    if (tables[k][cell] != UNREACHABLE)
+                        landmarkDist16[(size_t)cell * landmarkCount + k] = tables[k][cell];
+        }
+        else
+        {
+            landmarkDist32.assign((size_t)cells * landmarkCount, UNREACHABLE);
+            for (int k = 0; k < landmarkCount; k++)
+                for (int cell = 0; cell < cells; cell++)
+                    landmarkDist32[(size_t)cell * landmarkCount + k] = tables[k][cell];
+        }
+    }
+
+    const vector<int> &landmarks() const
+    {
+        return landmarkCells;
+    }
+
+    pair<vector<pair<int, int>>, double> findPath(
+        pair<int, int> start,
+        pair<int, int> goal, bool useManhattan, SearchMode mode = SearchMode::AStar)
+    {
+        return findPath(start, goal, useManhattan ? Heuristic::Manhattan : Heuristic::Euclidean, mode);
+    }
+
+    /*
+        The JPS modes return paths of the same cost as A* under an admissible heuristic
+        (Chebyshev); with Manhattan or Euclidean, which overestimate when diagonal moves
+        cost 1, neither A* nor JPS is guaranteed to be optimal. The bidirectional mode
+        is optimal with Chebyshev or Landmarks, both of which are consistent.
+    */
+    pair<vector<pair<int, int>>, double> findPath(
+        pair<int, int> start,
+        pair<int, int> goal, Heuristic heuristic, SearchMode mode = SearchMode::AStar)
+    {
+        if (mode == SearchMode::JPSPlus && jumpDistances.size() != (size_t)width * height)
+        {
+            buildJumpDistances();
+        }
+        return findPath(scratch, start, goal, heuristic, mode);
+    }
+
+    /*
+        Solves a batch of queries on nThreads workers (0 = one per core) of the
+        solver's SearchPool, which keeps its threads and their SearchScratch between
+        batches; the map and tables are shared read-only. Queries are dealt out in
+        chunks and idle workers steal chunks from busy ones (see SearchPool).
+    */
+    BatchPaths solveBatch(const vector<PathQuery> &queries, Heuristic heuristic,
+                          SearchMode mode = SearchMode::AStar, int nThreads = 0)
+    {
+        auto begin = chrono::steady_clock::now();
+        if (mode == SearchMode::JPSPlus && jumpDistances.size() != (size_t)width * height)
+        {
+            buildJumpDistances();
+        }
+        if (nThreads <= 0)
+            nThreads = max(1u, thread::hardware_concurrency());
+        int n = queries.size();
+        nThreads = max(1, min(nThreads, n));
+        if (!pool)
+            pool = make_unique<SearchPool>();
+
+        // Each worker appends its paths to its own arena; they are joined at the end
+        vector<vector<pair<int, int>>> arenas(nThreads);
+        vector<int> owner(n);
+        vector<size_t> local(n), lengths(n);
+        vector<long long> expanded(nThreads, 0);
+        BatchPaths result;
+        result.costs.resize(n);
+
+        pool->run(n, nThreads, [&](int id, SearchScratch &search, int q)
+                  {
+            auto path = findPath(search, queries[q].start, queries[q].goal, heuristic, mode);
+            expanded[id] += search.expanded;
+            owner[q] = id;
+            local[q] = arenas[id].size();
+            lengths[q] = path.first.size();
+            result.costs[q] = path.second;
+            arenas[id].insert(arenas[id].end(), path.first.begin(), path.first.end()); });
+
+        result.offsets.resize(n + 1, 0);
+        for (int q = 0; q < n; q++)
+            result.offsets[q + 1] = result.offsets[q] + lengths[q];
+        result.cells.resize(result.offsets[n]);
+        for (int q = 0; q < n; q++)
+            copy_n(arenas[owner[q]].begin() + local[q], lengths[q], result.cells.begin() + result.offsets[q]);
+        for (long long count : expanded)
+            result.expanded += count;
+        result.seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        return result;
+    }
+};
+
+/*
+    D* Lite (Koenig and Likhachev): incremental replanning on a changing map.
+
+    The search runs backwards from the goal, so g(s) estimates the distance from s
+    to the goal and rhs(s) is the one-step lookahead min over neighbours s' of
+    (1 + g(s')). Cells whose g and rhs disagree are inconsistent and sit in the
+    priority queue. When cells change, only the changed cells and their neighbours
+    get a new rhs; the repair then spreads from them and stops as soon as the path
+    from the agent's current cell is consistent again, so the work follows the size
+    of the change rather than the size of the map. Moving the agent only adds the
+    distance moved to km, keeping old queue keys valid lower bounds.
+
+    Changes go through GridSolver::setCell, so the solver sees the same map.
+*/
+struct CellUpdate
+{
+    int x, y;
+    bool free;
+};
+
+class DStarLite
 {
-    int x, y;                // Current coordinates
-    double g_cost = DBL_MAX; // Cost from start to current node
-    double h_cost = 0;       // Estimated cost from current to goal
-    double f_cost = DBL_MAX; // Total cost (g + h)
-    Node *parent = nullptr;  // Parent node
+private:
+    struct QueueEntry
+    {
+        double k1, k2;
+        int cell;
+
+        bool operator>(const QueueEntry &other) const
+        {
+            return k1 != other.k1 ? k1 > other.k1 : k2 > other.k2;
+        }
+    };
+
+    GridSolver &solver;
+    int width, height;
+    int start, goal, last;
+    double km = 0;
+    vector<double> g, rhs;
+    vector<pair<double, double>> queuedKey; // key of the live queue entry of a cell
+    vector<char> inQueue;
+    priority_queue<QueueEntry, vector<QueueEntry>, greater<QueueEntry>> open;
+    long long expanded = 0;
 
-    Node(int x, int y) : x(x), y(y) {}
+    static constexpr int dx8[8] = {-1, 1, 0, 0, -1, -1, 1, 1};
+    static constexpr int dy8[8] = {0, 0, -1, 1, -1, 1, -1, 1};
 
-    bool operator<(const Node &other) const
+    double heuristic(int a, int b) const
     {
-        if (x != other.x)
-            return x < other.x;
-        return y < other.y;
+        return max(abs(a % width - b % width), abs(a / width - b / width));
     }
-};
 
-class Compare
-{
-public:
-    bool operator()(const Node *below, const Node *above)
+    // Index of a cell, or -1 off the grid
+    int cellIndex(pair<int, int> cell) const
     {
-        return below->f_cost > above->f_cost;
-    };
-};
+        if (cell.first < 0 || cell.first >= width || cell.second < 0 || cell.second >= height)
+            return -1;
+        return cell.second * width + cell.first;
+    }
 
-class GridSolver
-{
-private:
-    int width, height;
-    vector<vector<int>> grid;
+    pair<double, double> calculateKey(int cell) const
+    {
+        double best = min(g[cell], rhs[cell]);
+        return {best + heuristic(start, cell) + km, best};
+    }
 
-    vector<pair<int, int>> directions = {
-        {-1, 0}, {1, 0}, {0, -1}, {0, 1}, {-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
+    template <typename Visit>
+    void forEachNeighbour(int cell, Visit visit)
+    {
+        int x = cell % width, y = cell / width;
+        if (!solver.passable(x, y))
+            return;
+        unsigned passable = solver.map().neighbourMask(x, y);
+        for (int d = 0; d < 8; d++)
+            if (passable >> d & 1)
+                visit((y + dy8[d]) * width + x + dx8[d]);
+    }
 
-    double calculateHCostEuclidean(const Node &current, const Node &goal)
+    // Around a changed cell every neighbour's edge to it changes, free or not
+    template <typename Visit>
+    void forEachCellAround(int cell, Visit visit)
     {
-        double dx = current.x - goal.x;
-        double dy = current.y - goal.y;
-        return sqrt(dx * dx + dy * dy);
+        int x = cell % width, y = cell / width;
+        for (int d = 0; d < 8; d++)
+        {
+            int nx = x + dx8[d], ny = y + dy8[d];
+            if (nx >= 0 && nx < width && ny >= 0 && ny < height)
+                visit(ny * width + nx);
+        }
     }
 
-    double calculateHCostManhattan(const Node &current, const Node &goal)
+    void updateVertex(int cell)
     {
-        double dx = abs(current.x - goal.x) * 1.0;
-        double dy = abs(current.y - goal.y) * 1.0;
-        return dx + dy;
+        if (cell != goal)
+        {
+            double best = DBL_MAX;
+            forEachNeighbour(cell, [&](int next)
+                             {
+                if (g[next] != DBL_MAX)
+                    best = min(best, g[next] + 1); });
+            rhs[cell] = best;
+        }
+        if (g[cell] != rhs[cell])
+        {
+            queuedKey[cell] = calculateKey(cell);
+            inQueue[cell] = 1;
+            open.push({queuedKey[cell].first, queuedKey[cell].second, cell});
+        }
+        else
+        {
+            inQueue[cell] = 0;
+        }
     }
 
-    bool isValid(int x, int y)
+    // Drops entries that were superseded or removed
+    bool topIsLive()
     {
-        return x >= 0 && x < width && y >= 0 && y < height && grid[y][x] != 0;
+        while (!open.empty())
+        {
+            const QueueEntry &top = open.top();
+            if (inQueue[top.cell] && queuedKey[top.cell] == make_pair(top.k1, top.k2))
+                return true;
+            open.pop();
+        }
+        return false;
     }
 
 public:
-    GridSolver(int w, int h, const vector<vector<int>> &obstacles)
-        : width(w), height(h), grid(obstacles) {}
+    DStarLite(GridSolver &solver, int width, int height, pair<int, int> startCell, pair<int, int> goalCell)
+        : solver(solver), width(width), height(height),
+          g(width * height, DBL_MAX), rhs(width * height, DBL_MAX),
+          queuedKey(width * height), inQueue(width * height, 0)
+    {
+        start = last = cellIndex(startCell);
+        goal = cellIndex(goalCell);
+        if (goal == -1)
+            return;
+        // A blocked goal is seeded too, so freeing it later repairs the search
+        rhs[goal] = 0;
+        queuedKey[goal] = calculateKey(goal);
+        inQueue[goal] = 1;
+        open.push({queuedKey[goal].first, queuedKey[goal].second, goal});
+    }
 
-    pair<vector<pair<int, int>>, double> findPath(
-        pair<int, int> start,
-        pair<int, int> goal, bool useManhattan)
+    // Cells expanded by the last computeShortestPath call
+    long long lastExpansions() const
     {
-        // Check if start and end are valid
-        if (!isValid(start.first, start.second) || !isValid(goal.first, goal.second))
+        return expanded;
+    }
+
+    void computeShortestPath()
+    {
+        expanded = 0;
+        if (start == -1)
+            return;
+        while (topIsLive())
+        {
+            QueueEntry top = open.top();
+            pair<double, double> startKey = calculateKey(start);
+            if (!(make_pair(top.k1, top.k2) < startKey) && rhs[start] == g[start])
+                break;
+
+            int cell = top.cell;
+            pair<double, double> newKey = calculateKey(cell);
+            expanded++;
+            if (make_pair(top.k1, top.k2) < newKey)
+            {
+                // Key grew after km changed; requeue with the current key
+                open.pop();
+                queuedKey[cell] = newKey;
+                open.push({newKey.first, newKey.second, cell});
+            }
+            else if (g[cell] > rhs[cell])
+            {
+                open.pop();
+                inQueue[cell] = 0;
+                g[cell] = rhs[cell];
+                forEachNeighbour(cell, [&](int next)
+                                 { updateVertex(next); });
+            }
+            else
+            {
+                open.pop();
+                g[cell] = DBL_MAX;
+                updateVertex(cell);
+                forEachNeighbour(cell, [&](int next)
+                                 { updateVertex(next); });
+            }
+        }
+    }
+
+    // The agent has moved to a new cell
+    void moveStart(pair<int, int> cell)
+    {
+        start = cellIndex(cell);
+        if (start == -1)
+            return;
+        km += heuristic(last, start);
+        last = start;
+    }
+
+    // Applies a batch of cell changes to the solver's map and repairs the affected vertices
+    void updateCells(const vector<CellUpdate> &updates)
+    {
+        vector<int> touched;
+        for (const CellUpdate &update : updates)
         {
+            if (solver.passable(update.x, update.y) == update.free)
+                continue;
+            solver.setCell(update.x, update.y, update.free);
+            int cell = update.y * width + update.x;
+            touched.push_back(cell);
+            forEachCellAround(cell, [&](int next)
+                              { touched.push_back(next); });
+        }
+        sort(touched.begin(), touched.end());
+        touched.erase(unique(touched.begin(), touched.end()), touched.end());
+        // A blocked cell has no neighbours, so updateVertex gives it rhs = infinity
+        for (int cell : touched)
+            updateVertex(cell);
+    }
+
+    // Current best path from the agent's cell to the goal, following the smallest g
+    pair<vector<pair<int, int>>, double> currentPath()
+    {
+        // Same rule as GridSolver::findPath: both ends must be free cells on the grid
+        if (start == -1 || goal == -1 || !solver.passable(start % width, start / width) ||
+            !solver.passable(goal % width, goal / width))
             return {vector<pair<int, int>>(), DBL_MAX};
+        computeShortestPath();
+        if (g[start] == DBL_MAX)
+            return {vector<pair<int, int>>(), DBL_MAX};
+
+        vector<pair<int, int>> path = {{start % width, start / width}};
+        int cell = start;
+        while (cell != goal && path.size() <= (size_t)width * height)
+        {
+            int next = -1;
+            forEachNeighbour(cell, [&](int candidate)
+                             {
+                if (g[candidate] != DBL_MAX && (next == -1 || g[candidate] < g[next]))
+                    next = candidate; });
+            if (next == -1)
+                return {vector<pair<int, int>>(), DBL_MAX};
+            cell = next;
+            path.push_back({cell % width, cell / width});
         }
+        return {path, g[start]};
+    }
+};
+
+/*
+    Hierarchical pathfinding (HPA*) over the map of a GridSolver.
+
+    The map is cut into square clusters. Wherever two neighbouring clusters touch
+    through free cells, entrance nodes are placed on both sides of the border
+    (one per short opening, two at the ends of a long one), and every diagonal
+    crossing not covered by such an opening gets its own pair. Inside each
+    cluster the distances between its entrance nodes are found once by a BFS
+    limited to the cluster; clusters are independent, so this runs in parallel.
+
+    A query links start and goal to the entrances of their clusters, runs A* on
+    the small abstract graph and refines each abstract edge into cells on demand.
+    Refined segments between two entrance nodes are kept in a bounded LRU
+    cache; the first and last segments of a query run from its own start and
+    goal cells, so they are refined every time. Paths are near-optimal rather
+    than optimal. The abstract graph describes the map at construction time, so
+    it has to be rebuilt after cells change.
+*/
+class HierarchicalGridSolver
+{
+private:
+    struct Edge
+    {
+        int to;
+        int cost;
+    };
+
+    const GridBitmap &grid;
+    int width, height;
+    int clusterSize;
+    int clustersX, clustersY;
 
-        Node startNode(start.first, start.second);
-        Node goalNode(goal.first, goal.second);
+    vector<int> nodeCell;                   // abstract node -> cell index
+    unordered_map<int, int> cellNode;       // cell index -> abstract node
+    vector<vector<int>> clusterNodes;       // cluster -> its abstract nodes
+    vector<vector<Edge>> edges;             // adjacency of the abstract graph
 
-        priority_queue<Node *, vector<Node *>, Compare> pq;
-        map<Node, Node *> nodes;
+    // LRU cache of refined entrance-to-entrance segments
+    size_t segmentCapacity;
+    list<uint64_t> segmentOrder; // most recently used first
+    unordered_map<uint64_t, pair<vector<int>, list<uint64_t>::iterator>> segments;
 
-        startNode.g_cost = 0;
-        startNode.h_cost = useManhattan ? calculateHCostManhattan(startNode, goalNode) : calculateHCostEuclidean(startNode, goalNode);
-        startNode.f_cost = startNode.g_cost + startNode.h_cost;
+    static constexpr int dx8[8] = {-1, 1, 0, 0, -1, -1, 1, 1};
+    static constexpr int dy8[8] = {0, 0, -1, 1, -1, 1, -1, 1};
 
-        Node *current = new Node(startNode);
-        nodes[startNode] = current;
-        pq.push(current);
+    int clusterOf(int x, int y) const
+    {
+        return (y / clusterSize) * clustersX + x / clusterSize;
+    }
+
+    bool isFree(int x, int y) const
+    {
+        return x >= 0 && x < width && y >= 0 && y < height && grid.passable(x, y);
+    }
+
+    int nodeFor(int x, int y)
+    {
+        int cell = y * width + x;
+        auto it = cellNode.find(cell);
+        if (it != cellNode.end())
+            return it->second;
+        int id = nodeCell.size();
+        nodeCell.push_back(cell);
+        cellNode[cell] = id;
+        edges.emplace_back();
+        clusterNodes[clusterOf(x, y)].push_back(id);
+        return id;
+    }
 
-        while (!pq.empty())
+    void addTransition(int ax, int ay, int bx, int by)
+    {
+        int a = nodeFor(ax, ay), b = nodeFor(bx, by);
+        for (const Edge &e : edges[a])
+            if (e.to == b)
+                return;
+        edges[a].push_back({b, 1});
+        edges[b].push_back({a, 1});
+    }
+
+    /*
+        Border between cells (x0, y0) + t * (stepX, stepY) and their neighbours
+        across at offset (acrossX, acrossY), for t in [0, length). Openings are
+        split wherever the cluster changes along the border.
+    */
+    void buildBorder(int x0, int y0, int stepX, int stepY, int acrossX, int acrossY, int length)
+    {
+        auto straight = [&](int t)
         {
-            current = pq.top();
-            pq.pop();
+            int x = x0 + t * stepX, y = y0 + t * stepY;
+            return isFree(x, y) && isFree(x + acrossX, y + acrossY);
+        };
 
-            if (current->x == goalNode.x && current->y == goalNode.y)
+        int runStart = -1;
+        for (int t = 0; t <= length; t++)
+        {
+            bool open = t < length && straight(t);
+            bool sameCluster = runStart >= 0 && t < length &&
+                               clusterOf(x0 + t * stepX, y0 + t * stepY) == clusterOf(x0 + runStart * stepX, y0 + runStart * stepY);
+            if (runStart >= 0 && (!open || !sameCluster))
             {
-                vector<pair<int, int>> path;
-                double finalCost = current->g_cost;
-
-                while (current != NULL)
+                int runEnd = t - 1;
+                vector<int> picks;
+                if (runEnd - runStart + 1 < 6)
+                    picks = {(runStart + runEnd) / 2};
+                else
+                    picks = {runStart, runEnd};
+                for (int p : picks)
                 {
-                    path.push_back({current->x, current->y});
-                    current = current->parent;
+                    int x = x0 + p * stepX, y = y0 + p * stepY;
+                    addTransition(x, y, x + acrossX, y + acrossY);
                 }
-                reverse(path.begin(), path.end());
+                runStart = -1;
+            }
+            if (open && runStart < 0)
+                runStart = t;
+        }
 
-                for (auto &pair : nodes)
+        // Diagonal crossings; covered when both ends also cross straight (then they share an opening)
+        for (int t = 0; t + 1 < length; t++)
+        {
+            for (int flip = 0; flip < 2; flip++)
+            {
+                int ta = flip ? t + 1 : t, tb = flip ? t : t + 1;
+                int ax = x0 + ta * stepX, ay = y0 + ta * stepY;
+                int bx = x0 + tb * stepX + acrossX, by = y0 + tb * stepY + acrossY;
+                if (!isFree(ax, ay) || !isFree(bx, by))
+                    continue;
+                bool sameRow = clusterOf(ax, ay) == clusterOf(x0 + tb * stepX, y0 + tb * stepY);
+                if (sameRow && straight(ta) && straight(tb))
+                    continue;
+                addTransition(ax, ay, bx, by);
+            }
+        }
+    }
+
+    /*
+        BFS from cell (sx, sy) restricted to the cluster's rectangle. dist and
+        parent are scratch arrays of clusterSize^2 entries indexed locally.
+    */
+    void clusterBFS(int cluster, int sx, int sy, vector<int> &dist, vector<int> &parent, int targetX = -1, int targetY = -1) const
+    {
+        int left = (cluster % clustersX) * clusterSize, top = (cluster / clustersX) * clusterSize;
+        int right = min(width, left + clusterSize), bottom = min(height, top + clusterSize);
+        int w = right - left;
+        fill(dist.begin(), dist.end(), -1);
+
+        vector<int> queue;
+        queue.reserve(clusterSize * clusterSize);
+        int source = (sy - top) * w + (sx - left);
+        dist[source] = 0;
+        parent[source] = -1;
+        queue.push_back(source);
+        for (size_t head = 0; head < queue.size(); head++)
+        {
+            int local = queue[head];
+            int x = left + local % w, y = top + local / w;
+            if (x == targetX && y == targetY)
+                return;
+            unsigned passable = grid.neighbourMask(x, y);
+            for (int d = 0; d < 8; d++)
+            {
+                int nx = x + dx8[d], ny = y + dy8[d];
+                if (!(passable >> d & 1) || nx < left || nx >= right || ny < top || ny >= bottom)
+                    continue;
+                int next = (ny - top) * w + (nx - left);
+                if (dist[next] == -1)
                 {
-                    delete pair.second;
+                    dist[next] = dist[local] + 1;
+                    parent[next] = local;
+                    queue.push_back(next);
                 }
-
-                return {path, finalCost};
             }
+        }
+    }
 
-            for (const auto &dir : directions)
+    // Distances from cell (x, y) to every entrance node of its cluster (unreachable ones omitted)
+    vector<Edge> linksInCluster(int x, int y, vector<int> &dist, vector<int> &parent) const
+    {
+        int cluster = clusterOf(x, y);
+        clusterBFS(cluster, x, y, dist, parent);
+        int left = (cluster % clustersX) * clusterSize, top = (cluster / clustersX) * clusterSize;
+        int w = min(width, left + clusterSize) - left;
+
+        vector<Edge> links;
+        for (int node : clusterNodes[cluster])
+        {
+            int cell = nodeCell[node];
+            int d = dist[(cell / width - top) * w + (cell % width - left)];
+            if (d >= 0)
+                links.push_back({node, d});
+        }
+        return links;
+    }
+
+    // Cells from a to b (both in one cluster), excluding a
+    vector<int> refineSegment(int a, int b)
+    {
+        bool cached = cellNode.count(a) && cellNode.count(b);
+        uint64_t key = (uint64_t)a << 32 | (uint32_t)b;
+        if (cached)
+        {
+            auto found = segments.find(key);
+            if (found != segments.end())
             {
-                int newX = current->x + dir.first;
-                int newY = current->y + dir.second;
+                segmentOrder.splice(segmentOrder.begin(), segmentOrder, found->second.second);
+                return found->second.first;
+            }
+        }
 
-                if (!isValid(newX, newY))
-                    continue;
+        int ax = a % width, ay = a / width, bx = b % width, by = b / width;
+        int cluster = clusterOf(ax, ay);
+        int left = (cluster % clustersX) * clusterSize, top = (cluster / clustersX) * clusterSize;
+        int w = min(width, left + clusterSize) - left;
 
-                // double movementCost = (dir.first != 0 && dir.second != 0) ? sqrt(2.0) : 1.0;
-                double movementCost = 1.0; // Considering diagonal movement is treated same as vertical or horizontal movement
-                double tentative_g = current->g_cost + movementCost;
+        vector<int> dist(clusterSize * clusterSize), parent(clusterSize * clusterSize);
+        clusterBFS(cluster, ax, ay, dist, parent, bx, by);
+        vector<int> cells;
+        int source = (ay - top) * w + (ax - left);
+        for (int local = (by - top) * w + (bx - left); local != source; local = parent[local])
+            cells.push_back((top + local / w) * width + left + local % w);
+        reverse(cells.begin(), cells.end());
+        if (!cached)
+            return cells;
+
+        if (segments.size() == segmentCapacity)
+        {
+            segments.erase(segmentOrder.back());
+            segmentOrder.pop_back();
+        }
+        segmentOrder.push_front(key);
+        segments[key] = {cells, segmentOrder.begin()};
+        return cells;
+    }
+
+public:
+    HierarchicalGridSolver(const GridSolver &solver, int clusterSize = 32, int nThreads = 0, size_t segmentCapacity = 4096)
+        : grid(solver.map()), width(grid.getWidth()), height(grid.getHeight()), clusterSize(clusterSize),
+          segmentCapacity(max<size_t>(segmentCapacity, 1))
+    {
+        clustersX = (width + clusterSize - 1) / clusterSize;
+        clustersY = (height + clusterSize - 1) / clusterSize;
+        clusterNodes.assign(clustersX * clustersY, vector<int>());
+
+        for (int k = clusterSize; k < width; k += clusterSize)
+            buildBorder(k - 1, 0, 0, 1, 1, 0, height);
+        for (int k = clusterSize; k < height; k += clusterSize)
+            buildBorder(0, k - 1, 1, 0, 0, 1, width);
 
-                Node neighbor(newX, newY);
-                if (nodes.find(neighbor) == nodes.end())
+        // Intra-cluster edges, one cluster per task
+        vector<vector<pair<int, Edge>>> intra(clusterNodes.size());
+        atomic<int> nextCluster{0};
+        auto worker = [&]()
+        {
+            vector<int> dist(clusterSize * clusterSize), parent(clusterSize * clusterSize);
+            for (int c = nextCluster++; c < (int)clusterNodes.size(); c = nextCluster++)
+            {
+                for (int node : clusterNodes[c])
                 {
-                    nodes[neighbor] = new Node(newX, newY);
+                    int cell = nodeCell[node];
+                    for (const Edge &e : linksInCluster(cell % width, cell / width, dist, parent))
+                        if (e.to != node)
+                            intra[c].push_back({node, e});
                 }
+            }
+        };
+        if (nThreads <= 0)
+            nThreads = max(1u, thread::hardware_concurrency());
+        vector<thread> threads;
+        for (int i = 0; i < nThreads; i++)
+            threads.emplace_back(worker);
+        for (thread &t : threads)
+            t.join();
+        for (const auto &list : intra)
+            for (const auto &[from, e] : list)
+                edges[from].push_back(e);
+    }
+
+    int abstractNodes() const
+    {
+        return nodeCell.size();
+    }
+
+    // Refined segments currently cached
+    size_t cachedSegments() const
+    {
+        return segments.size();
+    }
 
-                Node *neighborNode = nodes[neighbor];
-                if (tentative_g < neighborNode->g_cost)
+    /*
+        Abstract path as a list of cells: start, entrance nodes, goal. Consecutive
+        cells are either adjacent or in the same cluster. Empty if unreachable.
+    */
+    pair<vector<int>, double> findAbstractPath(pair<int, int> start, pair<int, int> goal)
+    {
+        if (!isFree(start.first, start.second) || !isFree(goal.first, goal.second))
+            return {vector<int>(), DBL_MAX};
+
+        vector<int> dist(clusterSize * clusterSize), parent(clusterSize * clusterSize);
+        int n = nodeCell.size();
+        int startNode = n, goalNode = n + 1;
+        int startCell = start.second * width + start.first, goalCell = goal.second * width + goal.first;
+
+        vector<Edge> startLinks = linksInCluster(start.first, start.second, dist, parent);
+        unordered_map<int, int> goalLinks; // node -> cost to the goal
+        for (const Edge &e : linksInCluster(goal.first, goal.second, dist, parent))
+            goalLinks[e.to] = e.cost;
+        if (clusterOf(start.first, start.second) == clusterOf(goal.first, goal.second))
+        {
+            clusterBFS(clusterOf(goal.first, goal.second), goal.first, goal.second, dist, parent);
+            int cluster = clusterOf(start.first, start.second);
+            int left = (cluster % clustersX) * clusterSize, top = (cluster / clustersX) * clusterSize;
+            int w = min(width, left + clusterSize) - left;
+            int d = dist[(start.second - top) * w + (start.first - left)];
+            if (d >= 0)
+                startLinks.push_back({goalNode, d});
+        }
+
+        auto cellOf = [&](int node)
+        {
+            return node == startNode ? startCell : node == goalNode ? goalCell : nodeCell[node];
+        };
+        auto heuristic = [&](int node)
+        {
+            int cell = cellOf(node);
+            return max(abs(cell % width - goal.first), abs(cell / width - goal.second));
+        };
+
+        unordered_map<int, int> g;
+        unordered_map<int, int> from;
+        priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> open;
+        g[startNode] = 0;
+        open.push({heuristic(startNode), startNode});
+
+        while (!open.empty())
+        {
+            auto [f, node] = open.top();
+            open.pop();
+            int gNode = g[node];
+            if (f - heuristic(node) > gNode)
+                continue;
+            if (node == goalNode)
+            {
+                vector<int> cells;
+                for (int v = goalNode; v != startNode; v = from[v])
+                    cells.push_back(cellOf(v));
+                cells.push_back(startCell);
+                reverse(cells.begin(), cells.end());
+                return {cells, (double)gNode};
+            }
+
+            auto relax = [&](int to, int cost)
+            {
+                auto it = g.find(to);
+                if (it == g.end() || gNode + cost < it->second)
                 {
-                    neighborNode->parent = current;
-                    neighborNode->g_cost = tentative_g;
-                    neighborNode->h_cost = useManhattan ? calculateHCostManhattan(*neighborNode, goalNode) : calculateHCostEuclidean(*neighborNode, goalNode);
-                    neighborNode->f_cost = neighborNode->g_cost + neighborNode->h_cost;
-                    pq.push(neighborNode);
+                    g[to] = gNode + cost;
+                    from[to] = node;
+                    open.push({gNode + cost + heuristic(to), to});
                 }
-            }
+            };
+            const vector<Edge> &out = node == startNode ? startLinks : edges[node];
+            for (const Edge &e : out)
+                relax(e.to, e.cost);
+            auto link = goalLinks.find(node);
+            if (link != goalLinks.end())
+                relax(goalNode, link->second);
         }
+        return {vector<int>(), DBL_MAX};
+    }
+
+    // Full cell path in the same format as GridSolver::findPath
+    pair<vector<pair<int, int>>, double> findPath(pair<int, int> start, pair<int, int> goal)
+    {
+        auto abstractPath = findAbstractPath(start, goal);
+        if (abstractPath.first.empty())
+            return {vector<pair<int, int>>(), DBL_MAX};
 
-        for (auto &pair : nodes)
+        const vector<int> &cells = abstractPath.first;
+        vector<pair<int, int>> path = {{cells[0] % width, cells[0] / width}};
+        for (size_t i = 1; i < cells.size(); i++)
         {
-            delete pair.second;
+            int a = cells[i - 1], b = cells[i];
+            if (a == b)
+                continue;
+            int ax = a % width, ay = a / width, bx = b % width, by = b / width;
+            if (clusterOf(ax, ay) != clusterOf(bx, by))
+            {
+                path.push_back({bx, by}); // transition between adjacent cells
+                continue;
+            }
+            for (int cell : refineSegment(a, b))
+                path.push_back({cell % width, cell / width});
         }
-        return {vector<pair<int, int>>(), DBL_MAX};
+        return {path, abstractPath.second};
+    }
+};
+
+void printResult(const string &label, const pair<vector<pair<int, int>>, double> &result)
+{
+    if (result.second == DBL_MAX)
+    {
+        cout << "Could not find a path using " << label << "\n";
+        return;
+    }
+    cout << "Path found using " << label << " with cost " << result.second << ":\n";
+    for (int i = 0; i < result.first.size(); i++)
+    {
+        if (i < result.first.size() - 1)
+            cout << "< " << result.first[i].second << " , " << result.first[i].first << " > ---- ";
+        else
+            cout << "< " << result.first[i].second << " , " << result.first[i].first << " >";
+    }
+    cout << "\n";
+}
+
+/*
+    MovingAI benchmark files (movingai.com/benchmarks). A .map file is a header
+    ("type octile", "height H", "width W", "map") followed by H rows of W
+    characters; '.', 'G' and 'S' are passable, everything else ('@', 'O', 'T', 'W')
+    is not. Throws if the file cannot be read.
+*/
+GridBitmap loadMovingAIMap(const string &path)
+{
+    ifstream in(path);
+    if (!in)
+        throw runtime_error("cannot open " + path);
+    string key;
+    int w = -1, h = -1;
+    while (in >> key && key != "map")
+    {
+        if (key == "height")
+            in >> h;
+        else if (key == "width")
+            in >> w;
+        else
+            in >> key; // type
     }
+    if (w <= 0 || h <= 0)
+        throw runtime_error(path + " is not a MovingAI map");
+
+    GridBitmap map(w, h);
+    string row;
+    for (int y = 0; y < h && in >> row; y++)
+        for (int x = 0; x < w && x < (int)row.size(); x++)
+            if (row[x] == '.' || row[x] == 'G' || row[x] == 'S')
+                map.set(x, y, true);
+    return map;
+}
+
+// One line of a .scen file: bucket, map, map size, start, goal and the optimal octile length
+struct Scenario
+{
+    int bucket;
+    string map;
+    int mapWidth, mapHeight;
+    pair<int, int> start, goal;
+    double optimal;
 };
 
-int main()
+vector<Scenario> loadMovingAIScenarios(const string &path)
+{
+    ifstream in(path);
+    if (!in)
+        throw runtime_error("cannot open " + path);
+    vector<Scenario> scenarios;
+    string line;
+    while (getline(in, line))
+    {
+        istringstream fields(line);
+        Scenario scenario;
+        if (fields >> scenario.bucket >> scenario.map >> scenario.mapWidth >> scenario.mapHeight >>
+            scenario.start.first >> scenario.start.second >> scenario.goal.first >> scenario.goal.second >> scenario.optimal)
+            scenarios.push_back(scenario);
+    }
+    return scenarios;
+}
+
+// Length of a path when diagonal moves cost sqrt(2), as in the MovingAI optima
+double octileLength(const vector<pair<int, int>> &path)
+{
+    double length = 0;
+    for (size_t i = 1; i < path.size(); i++)
+        length += path[i].first != path[i - 1].first && path[i].second != path[i - 1].second ? sqrt(2.0) : 1.0;
+    return length;
+}
+
+// A field of /proc/self/status in kilobytes ("VmRSS" now, "VmHWM" peak), -1 if unavailable
+long statusMemoryKB(const string &field)
+{
+    ifstream in("/proc/self/status");
+    string line;
+    while (getline(in, line))
+        if (line.compare(0, field.size() + 1, field + ":") == 0)
+            return atol(line.c_str() + field.size() + 1);
+    return -1;
+}
+
+/*
+    Hands freed heap memory back to the system and restarts the peak (VmHWM) at
+    the current resident size, so the next peak belongs to what runs after.
+    Returns false if the kernel cannot reset the peak.
+*/
+bool resetPeakMemory()
+{
+    malloc_trim(0);
+    ofstream out("/proc/self/clear_refs");
+    out << "5";
+    out.flush();
+    return bool(out);
+}
+
+/*
+    Runs every scenario through each planner and prints expansions, time
+    percentiles and agreement. The searches here cost 1 per move and may cut
+    corners, while the scenario optima are octile lengths without corner cutting,
+    so the two are compared through the octile length of our path: "longer" and
+    "shorter" count paths whose octile length differs from the optimum (shorter
+    ones cut corners). Agreement with plain A* is the correctness check: every
+    planner must return its cost except HPA*, which is only near-optimal. D* Lite
+    is planned from scratch for each scenario and the flow field is built per goal
+    (through the solver's cache), so their times include that setup; HPA* and the
+    flow field do not count expansions. "peak +MB" is each planner's own peak
+    resident memory above what was resident before it ran (the shared tables
+    built up front are reported once, after setup).
+*/
+void runBenchmark(const string &mapPath, const string &scenPath)
+{
+    auto begin = chrono::steady_clock::now();
+    GridSolver gs(loadMovingAIMap(mapPath));
+    vector<Scenario> scenarios = loadMovingAIScenarios(scenPath);
+    double loadMs = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+    int width = gs.map().getWidth(), height = gs.map().getHeight();
+    cout << mapPath << ": " << width << " x " << height << ", "
+         << scenarios.size() << " scenarios, loaded in " << fixed << setprecision(1) << loadMs << " ms\n";
+
+    begin = chrono::steady_clock::now();
+    gs.buildComponents();
+    gs.buildLandmarks(8);
+    gs.buildJumpTable();
+    HierarchicalGridSolver hpa(gs);
+    double setupMs = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+    cout << "Components, 8 landmarks, the JPS+ table and the HPA* graph (" << hpa.abstractNodes()
+         << " nodes) built in " << setupMs << " ms, " << statusMemoryKB("VmRSS") / 1024.0 << " MB resident\n\n";
+
+    using Result = pair<vector<pair<int, int>>, double>;
+    struct Planner
+    {
+        string name;
+        bool countsExpansions;
+        function<Result(const Scenario &, long long &)> run; // adds its expansions to the counter
+    };
+    auto gridMode = [&gs](Heuristic heuristic, SearchMode mode)
+    {
+        return [&gs, heuristic, mode](const Scenario &scenario, long long &expanded)
+        {
+            Result result = gs.findPath(scenario.start, scenario.goal, heuristic, mode);
+            expanded += gs.lastExpansions();
+            return result;
+        };
+    };
+    vector<Planner> planners = {
+        {"A* (Chebyshev)", true, gridMode(Heuristic::Chebyshev, SearchMode::AStar)},
+        {"A* (Landmarks)", true, gridMode(Heuristic::Landmarks, SearchMode::AStar)},
+        {"Bidirectional A*", true, gridMode(Heuristic::Chebyshev, SearchMode::Bidirectional)},
+        {"JPS", true, gridMode(Heuristic::Chebyshev, SearchMode::JPS)},
+        {"JPS+", true, gridMode(Heuristic::Chebyshev, SearchMode::JPSPlus)},
+        {"HPA*", false, [&hpa](const Scenario &scenario, long long &)
+         { return hpa.findPath(scenario.start, scenario.goal); }},
+        {"D* Lite", true, [&](const Scenario &scenario, long long &expanded)
+         {
+             DStarLite planner(gs, width, height, scenario.start, scenario.goal);
+             Result result = planner.currentPath();
+             expanded += planner.lastExpansions();
+             return result;
+         }},
+        {"Flow field", false, [&gs](const Scenario &scenario, long long &)
+         {
+             shared_ptr<const FlowField> field = gs.flowField(scenario.goal);
+             return field ? field->pathFrom(scenario.start) : Result(vector<pair<int, int>>(), DBL_MAX);
+         }}};
+
+    cout << left << setw(18) << "planner" << right << setw(12) << "expanded" << setw(10) << "p50 us" << setw(10) << "p95 us"
+         << setw(10) << "p99 us" << setw(10) << "vs A*" << setw(9) << "equal" << setw(9) << "longer" << setw(9) << "shorter"
+         << setw(9) << "missing" << setw(12) << "peak +MB" << "\n";
+
+    vector<double> reference(scenarios.size(), -1);
+    for (const Planner &planner : planners)
+    {
+        bool peakReset = resetPeakMemory();
+        long residentKB = statusMemoryKB("VmRSS");
+        vector<double> micros;
+        long long expanded = 0;
+        int agree = 0, equal = 0, longer = 0, shorter = 0, missing = 0;
+        for (size_t i = 0; i < scenarios.size(); i++)
+        {
+            const Scenario &scenario = scenarios[i];
+            auto start = chrono::steady_clock::now();
+            Result result = planner.run(scenario, expanded);
+            micros.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+
+            if (reference[i] < 0)
+                reference[i] = result.second;
+            agree += result.second == reference[i];
+            if (result.second == DBL_MAX)
+            {
+                missing++;
+                continue;
+            }
+            double octile = octileLength(result.first);
+            if (fabs(octile - scenario.optimal) < 1e-4 * max(1.0, scenario.optimal))
+                equal++;
+            else if (octile > scenario.optimal)
+                longer++;
+            else
+                shorter++;
+        }
+
+        long peakKB = statusMemoryKB("VmHWM");
+        string peak = "-";
+        if (peakReset && residentKB >= 0 && peakKB >= 0)
+        {
+            ostringstream text;
+            text << fixed << setprecision(1) << max(0L, peakKB - residentKB) / 1024.0;
+            peak = text.str();
+        }
+
+        sort(micros.begin(), micros.end());
+        auto percentile = [&](double p)
+        {
+            return micros.empty() ? 0.0 : micros[min(micros.size() - 1, (size_t)(p * micros.size()))];
+        };
+        cout << left << setw(18) << planner.name << right << setw(12)
+             << (planner.countsExpansions ? to_string(expanded) : "-") << setprecision(1)
+             << setw(10) << percentile(0.50) << setw(10) << percentile(0.95) << setw(10) << percentile(0.99)
+             << setw(10) << agree << setw(9) << equal << setw(9) << longer << setw(9) << shorter << setw(9) << missing
+             << setw(12) << peak << "\n";
+    }
+}
+
+int main(int argc, char *argv[])
 {
+    // MovingAI benchmark: a .map file and a .scen file
+    if (argc > 1 && string(argv[1]) == "--bench")
+    {
+        if (argc < 4)
+        {
+            cout << "Usage: " << argv[0] << " --bench file.map file.scen\n";
+            return 0;
+        }
+        runBenchmark(argv[2], argv[3]);
+        return 0;
+    }
+
+    // A binary map written by GridBitmap::save, or a MovingAI .map, can be given instead of entering the grid
+    if (argc > 1)
+    {
+        string path = argv[1];
+        bool movingAI = path.size() > 4 && path.substr(path.size() - 4) == ".map";
+        GridSolver gs(movingAI ? loadMovingAIMap(path) : GridBitmap::load(path));
+        cout << "Loaded a " << gs.map().getHeight() << " x " << gs.map().getWidth() << " grid\n";
+
+        cout << "Enter the start state coordinates:\n";
+        int sx, sy;
+        cin >> sx >> sy;
+        cout << "Enter the goal state coordinates:\n";
+        int ex, ey;
+        cin >> ex >> ey;
+
+        auto result = gs.findPath({sy, sx}, {ey, ex}, Heuristic::Chebyshev, SearchMode::JPSPlus);
+        printResult("Jump Point Search", result);
+        return 0;
+    }
+
     int m, n;
     cout << "Enter the number of rows of the grid:\n";
     cin >> m;
@@ -195,41 +2937,15 @@ int main()
 
     // Manhattan heuristic
     auto result = gs.findPath({sy, sx}, {ey, ex}, true);
-    if (result.second == DBL_MAX)
-    {
-        cout << "Could not find a path using Manhattan heuristic\n";
-    }
-    else
-    {
-        cout << "Path found using Manhattan heuristic with cost " << result.second << ":\n";
-        for (int i = 0; i < result.first.size(); i++)
-        {
-            if (i < result.first.size() - 1)
-                cout << "< " << result.first[i].second << " , " << result.first[i].first << " > ---- ";
-            else
-                cout << "< " << result.first[i].second << " , " << result.first[i].first << " >";
-        }
-        cout << "\n";
-    }
+    printResult("Manhattan heuristic", result);
 
     // Euclidean heuristic
     result = gs.findPath({sy, sx}, {ey, ex}, false);
-    if (result.second == DBL_MAX)
-    {
-        cout << "Could not find a path using Euclidean heuristic\n";
-    }
-    else
-    {
-        cout << "Path found using Euclidean heuristic with cost " << result.second << ":\n";
-        for (int i = 0; i < result.first.size(); i++)
-        {
-            if (i < result.first.size() - 1)
-                cout << "< " << result.first[i].second << " , " << result.first[i].first << " > ---- ";
-            else
-                cout << "< " << result.first[i].second << " , " << result.first[i].first << " >";
-        }
-        cout << "\n";
-    }
+    printResult("Euclidean heuristic", result);
+
+    // Jump Point Search, optimal with the Chebyshev heuristic
+    result = gs.findPath({sy, sx}, {ey, ex}, Heuristic::Chebyshev, SearchMode::JPSPlus);
+    printResult("Jump Point Search", result);
 
     return 0;
 }
@@ -1,225 +1,1172 @@
 #include <bits/stdc++.h>
+#include <sys/resource.h>
 using namespace std;
 
-struct Node
+// Fixed-size set of node ids, one bit each
+struct Bitset
 {
-    string id;                             // Label
-    int value;                             // Heuristic Value
-    bool isGoal;                           // whether goal state or not
-    bool isObstacle;                       // whether obstacle or not
-    double totalCost;                      // totalCost -> actual + heuristic
-    vector<Node *> successors;             // successor nodes in the path
-    vector<pair<Node *, Node *>> andPairs; // Nodes joined via hyperedge
-
-    Node(string id, int value, bool isGoal = false, bool isObstacle = false)
-        : id(id), value(value), isGoal(isGoal), isObstacle(isObstacle), totalCost(numeric_limits<double>::infinity()) {}
+    vector<uint64_t> words;
+
+    void resize(size_t bits)
+    {
+        words.assign((bits + 63) / 64, 0);
+    }
+
+    bool test(uint32_t i) const
+    {
+        return words[i >> 6] >> (i & 63) & 1;
+    }
+
+    void set(uint32_t i)
+    {
+        words[i >> 6] |= 1ULL << (i & 63);
+    }
+
+    void reset(uint32_t i)
+    {
+        words[i >> 6] &= ~(1ULL << (i & 63));
+    }
 };
 
-class AOStarSearch
+/*
+    Frozen AND/OR graph in compressed sparse row form. Nodes are numbered
+    0 .. size()-1 in the order they were added to the builder, and every list is
+    one slice of a flat array:
+
+        OR edges of u:       orTarget[orStart[u] .. orStart[u + 1]), costs in orCost
+        hyperedges of u:     andStart[u] .. andStart[u + 1], costs in edgeCost
+        children of edge e:  andTarget[edgeStart[e] .. edgeStart[e + 1])
+        parents of v:        parent[parentStart[v] .. parentStart[v + 1])
+
+    Parents are the nodes with any connector to v, each listed once. Following an
+    OR edge costs its edge cost plus the child's cost; a hyperedge costs its edge
+    cost plus the costs of all its children.
+*/
+struct AndOrGraph
+{
+    uint32_t nodes = 0;
+    vector<int> value;     // heuristic value of each node
+    Bitset goal, obstacle;
+
+    vector<uint32_t> orStart, orTarget;
+    vector<double> orCost;
+    vector<uint32_t> andStart, edgeStart, andTarget;
+    vector<double> edgeCost;
+    vector<uint32_t> parentStart, parent;
+
+    // Only named nodes have labels
+    unordered_map<string, uint32_t> ids;
+    unordered_map<uint32_t, string> names;
+
+    uint32_t size() const
+    {
+        return nodes;
+    }
+
+    // Id of a label, or UINT32_MAX if there is no such node
+    uint32_t id(const string &label) const
+    {
+        auto found = ids.find(label);
+        return found == ids.end() ? UINT32_MAX : found->second;
+    }
+
+    string label(uint32_t node) const
+    {
+        auto found = names.find(node);
+        return found == names.end() ? "#" + to_string(node) : found->second;
+    }
+
+    // Bytes held by the node and edge arrays (labels not included)
+    size_t memoryBytes() const
+    {
+        return value.size() * sizeof(int) + (goal.words.size() + obstacle.words.size()) * sizeof(uint64_t) +
+               (orStart.size() + orTarget.size() + andStart.size() + edgeStart.size() + andTarget.size() +
+                parentStart.size() + parent.size()) *
+                   sizeof(uint32_t) +
+               (orCost.size() + edgeCost.size()) * sizeof(double);
+    }
+};
+
+// Collects nodes and connectors, then freezes them into an AndOrGraph
+class AndOrGraphBuilder
 {
 private:
-    Node *startNode;
-    unordered_map<string, Node *> graph; // Label to Node map
+    unordered_map<string, uint32_t> ids;
+    unordered_map<uint32_t, string> names;
+    vector<int> values;
+    vector<char> goals, obstacles;
 
-    void evaluateNode(Node *node, set<string> &visited)
+    vector<uint32_t> orFrom, orTo;
+    vector<double> orCosts;
+    vector<uint32_t> andFrom, andChildStart = {0}, andChildren; // hyperedge e: andChildren[andChildStart[e] ..]
+    vector<double> andCosts;
+
+    uint32_t lookup(const string &label) const
     {
-        if (visited.count(node->id))
-            return;
-        visited.insert(node->id);
+        auto found = ids.find(label);
+        return found == ids.end() ? UINT32_MAX : found->second;
+    }
+
+public:
+    // Adds an unnamed node (printed as #id) and returns its id
+    uint32_t addNode(int value, bool isGoal = false, bool isObstacle = false)
+    {
+        values.push_back(value);
+        goals.push_back(isGoal);
+        obstacles.push_back(isObstacle);
+        return values.size() - 1;
+    }
 
-        if (node->isGoal)
+    // Adds a node, or updates it if the label exists; returns its id
+    uint32_t addNode(const string &label, int value, bool isGoal = false, bool isObstacle = false)
+    {
+        auto found = ids.find(label);
+        if (found == ids.end())
         {
-            node->totalCost = node->value;
-            return;
+            uint32_t node = addNode(value, isGoal, isObstacle);
+            ids[label] = node;
+            names[node] = label;
+            return node;
+        }
+        values[found->second] = value;
+        goals[found->second] = isGoal;
+        obstacles[found->second] = isObstacle;
+        return found->second;
+    }
+
+    uint32_t size() const
+    {
+        return values.size();
+    }
+
+    // Edge costs must be positive: a zero-cost cycle would look solved to itself
+    void addOREdge(uint32_t from, uint32_t to, double cost = 1)
+    {
+        if (!(cost > 0))
+            throw invalid_argument("edge costs must be positive");
+        orFrom.push_back(from);
+        orTo.push_back(to);
+        orCosts.push_back(cost);
+    }
+
+    void addOREdge(const string &u, const string &v, double cost = 1)
+    {
+        uint32_t from = lookup(u), to = lookup(v);
+        if (from != UINT32_MAX && to != UINT32_MAX)
+            addOREdge(from, to, cost);
+    }
+
+    // A hyperedge to any number of children; by default it costs 1 per child
+    void addANDEdge(uint32_t from, const vector<uint32_t> &children, double cost = -1)
+    {
+        if (cost < 0)
+            cost = children.size();
+        if (!(cost > 0))
+            throw invalid_argument("edge costs must be positive");
+        andFrom.push_back(from);
+        andChildren.insert(andChildren.end(), children.begin(), children.end());
+        andChildStart.push_back(andChildren.size());
+        andCosts.push_back(cost);
+    }
+
+    void addANDEdge(const string &u, const vector<string> &children, double cost = -1)
+    {
+        uint32_t from = lookup(u);
+        vector<uint32_t> ids;
+        for (const string &child : children)
+            ids.push_back(lookup(child));
+        if (from != UINT32_MAX && !ids.empty() && find(ids.begin(), ids.end(), UINT32_MAX) == ids.end())
+            addANDEdge(from, ids, cost);
+    }
+
+    void addANDPair(const string &u, const string &v1, const string &v2)
+    {
+        addANDEdge(u, {v1, v2});
+    }
+
+    // Builds the CSR arrays with counting sorts; connectors keep the order they were added in
+    AndOrGraph freeze() const
+    {
+        AndOrGraph graph;
+        uint32_t n = values.size();
+        graph.nodes = n;
+        graph.value = values;
+        graph.goal.resize(n);
+        graph.obstacle.resize(n);
+        for (uint32_t u = 0; u < n; u++)
+        {
+            if (goals[u])
+                graph.goal.set(u);
+            if (obstacles[u])
+                graph.obstacle.set(u);
         }
+        graph.ids = ids;
+        graph.names = names;
+
+        // start[u] = first slot of u; returns each item's slot
+        auto bucket = [n](vector<uint32_t> &start, const vector<uint32_t> &keys)
+        {
+            start.assign(n + 1, 0);
+            for (uint32_t key : keys)
+                start[key + 1]++;
+            for (uint32_t u = 0; u < n; u++)
+                start[u + 1] += start[u];
+            vector<uint32_t> next(start.begin(), start.end() - 1), slot(keys.size());
+            for (size_t i = 0; i < keys.size(); i++)
+                slot[i] = next[keys[i]]++;
+            return slot;
+        };
 
-        // First evaluate all successors
-        for (auto &successor : node->successors)
+        vector<uint32_t> slot = bucket(graph.orStart, orFrom);
+        graph.orTarget.resize(orTo.size());
+        graph.orCost.resize(orTo.size());
+        for (size_t e = 0; e < orTo.size(); e++)
         {
-            if (!successor->isObstacle && !visited.count(successor->id))
+            graph.orTarget[slot[e]] = orTo[e];
+            graph.orCost[slot[e]] = orCosts[e];
+        }
+
+        slot = bucket(graph.andStart, andFrom);
+        vector<uint32_t> order(andFrom.size());
+        for (size_t e = 0; e < andFrom.size(); e++)
+            order[slot[e]] = e;
+        graph.edgeStart.reserve(andFrom.size() + 1);
+        graph.edgeStart.push_back(0);
+        graph.andTarget.reserve(andChildren.size());
+        graph.edgeCost.reserve(andFrom.size());
+        for (uint32_t e : order)
+        {
+            graph.andTarget.insert(graph.andTarget.end(), andChildren.begin() + andChildStart[e], andChildren.begin() + andChildStart[e + 1]);
+            graph.edgeStart.push_back(graph.andTarget.size());
+            graph.edgeCost.push_back(andCosts[e]);
+        }
+
+        // Reverse edges, one per (child, parent)
+        vector<uint32_t> children, parents;
+        for (size_t e = 0; e < orFrom.size(); e++)
+        {
+            children.push_back(orTo[e]);
+            parents.push_back(orFrom[e]);
+        }
+        for (size_t e = 0; e < andFrom.size(); e++)
+            for (uint32_t i = andChildStart[e]; i < andChildStart[e + 1]; i++)
             {
-                evaluateNode(successor, visited);
+                children.push_back(andChildren[i]);
+                parents.push_back(andFrom[e]);
             }
+        slot = bucket(graph.parentStart, children);
+        vector<uint32_t> parent(parents.size());
+        for (size_t i = 0; i < parents.size(); i++)
+            parent[slot[i]] = parents[i];
+        graph.parent.reserve(parent.size());
+        for (uint32_t v = 0; v < n; v++)
+        {
+            size_t first = graph.parent.size();
+            graph.parent.insert(graph.parent.end(), parent.begin() + graph.parentStart[v], parent.begin() + graph.parentStart[v + 1]);
+            sort(graph.parent.begin() + first, graph.parent.end());
+            graph.parent.erase(unique(graph.parent.begin() + first, graph.parent.end()), graph.parent.end());
+            graph.parentStart[v] = first;
+        }
+        graph.parentStart[n] = graph.parent.size();
+        return graph;
+    }
+};
+
+/*
+    Seeded random AND/OR DAG for scaling tests. The nodes are split into
+    `layers` layers of equal width and every connector points from a layer to
+    the next few (up to `reach` layers down), so the graph is acyclic, as deep as
+    the number of layers and as wide as nodes / layers. The last layer is all
+    goals. Node 0 is the start and is named "S"; the rest are unnamed.
+    With backEdges > 0 that fraction of the OR edges point back up instead, to
+    any earlier layer, which closes cycles.
+*/
+struct GeneratorOptions
+{
+    uint32_t nodes = 100000;
+    uint32_t layers = 100;
+    int orEdges = 3;           // OR edges per node
+    int andEdges = 1;          // hyperedges per node
+    int maxArity = 4;          // children per hyperedge: 2 .. maxArity
+    int reach = 2;             // layers a connector may skip down
+    double goalFraction = 0.01;     // goals outside the last layer
+    double obstacleFraction = 0.05;
+    double maxEdgeCost = 5;    // edge costs are drawn from 1 .. maxEdgeCost
+    double backEdges = 0;
+    unsigned seed = 1;
+};
+
+AndOrGraph generateAndOrGraph(const GeneratorOptions &options)
+{
+    mt19937_64 rng(options.seed);
+    uniform_real_distribution<double> unit(0, 1), edgeCost(1, options.maxEdgeCost);
+    uniform_int_distribution<int> value(0, 9), arity(2, max(2, options.maxArity));
+
+    uint32_t layers = max<uint32_t>(2, min(options.layers, options.nodes));
+    uint32_t width = max<uint32_t>(1, options.nodes / layers);
+    uint32_t n = width * layers;
+    auto layerOf = [width](uint32_t node)
+    {
+        return node / width;
+    };
+    // A random node in one of the next `reach` layers below `node`
+    auto childOf = [&](uint32_t node)
+    {
+        uint32_t first = layerOf(node) + 1;
+        uint32_t last = min(layers - 1, layerOf(node) + max(1, options.reach));
+        uniform_int_distribution<uint32_t> pick(first * width, (last + 1) * width - 1);
+        return pick(rng);
+    };
+
+    AndOrGraphBuilder builder;
+    for (uint32_t node = 0; node < n; node++)
+    {
+        bool isGoal = layerOf(node) == layers - 1 || (node > 0 && unit(rng) < options.goalFraction);
+        bool isObstacle = !isGoal && node > 0 && unit(rng) < options.obstacleFraction;
+        if (node == 0)
+            builder.addNode("S", value(rng));
+        else
+            builder.addNode(value(rng), isGoal, isObstacle);
+    }
+
+    vector<uint32_t> children;
+    for (uint32_t node = 0; node < width * (layers - 1); node++)
+    {
+        for (int e = 0; e < options.orEdges; e++)
+        {
+            uint32_t child = unit(rng) < options.backEdges ? uniform_int_distribution<uint32_t>(0, node)(rng) : childOf(node);
+            builder.addOREdge(node, child, round(edgeCost(rng)));
+        }
+        for (int e = 0; e < options.andEdges; e++)
+        {
+            children.assign(arity(rng), 0);
+            for (uint32_t &child : children)
+                child = childOf(node);
+            builder.addANDEdge(node, children, round(edgeCost(rng)) * children.size());
         }
+    }
+    return builder.freeze();
+}
+
+/*
+    Node ids to process, shared by a fixed set of workers. Each worker has its own
+    deque: it pushes and takes at the back, and once its deque is empty it steals
+    from the front of the others. `pending` counts pushed items not finished yet,
+    so a worker that finds every deque empty knows whether more work can appear.
+*/
+class NodeQueues
+{
+private:
+    struct Queue
+    {
+        mutex lock;
+        deque<uint32_t> nodes;
+    };
+    vector<Queue> queues;
+    atomic<long long> pending{0};
 
-        // OR nodes
-        double minCost = numeric_limits<double>::infinity();
-        for (auto &successor : node->successors)
+    bool take(unsigned id, uint32_t &node)
+    {
+        for (unsigned i = 0; i < queues.size(); i++)
         {
-            if (!successor->isObstacle)
+            Queue &queue = queues[(id + i) % queues.size()];
+            lock_guard<mutex> guard(queue.lock);
+            if (queue.nodes.empty())
+                continue;
+            if (i == 0)
             {
-                double cost = node->value + successor->totalCost + 1; // 1 for the actual edge cost
-                minCost = min(minCost, cost);
+                node = queue.nodes.back();
+                queue.nodes.pop_back();
             }
+            else
+            {
+                node = queue.nodes.front();
+                queue.nodes.pop_front();
+            }
+            return true;
         }
+        return false;
+    }
 
-        // AND pairs
-        for (const auto &andPair : node->andPairs)
+public:
+    NodeQueues(unsigned workers) : queues(workers) {}
+
+    void push(unsigned id, uint32_t node)
+    {
+        pending++;
+        lock_guard<mutex> guard(queues[id].lock);
+        queues[id].nodes.push_back(node);
+    }
+
+    // Runs process(worker id, node) on every node pushed, including those pushed by process itself
+    template <typename Process>
+    void run(Process process)
+    {
+        auto worker = [&](unsigned id)
         {
-            if (!andPair.first->isObstacle && !andPair.second->isObstacle)
+            uint32_t node;
+            while (pending > 0)
             {
-                double andCost = node->value + andPair.first->totalCost + andPair.second->totalCost + 2; // taking twice edge cost
-                minCost = min(minCost, andCost);
+                if (!take(id, node))
+                {
+                    this_thread::yield();
+                    continue;
+                }
+                process(id, node);
+                pending--;
             }
+        };
+        vector<thread> threads;
+        for (unsigned id = 1; id < queues.size(); id++)
+            threads.emplace_back(worker, id);
+        worker(0);
+        for (thread &t : threads)
+            t.join();
+    }
+};
+
+/*
+    AO* search.
+
+    The search keeps a marked partial solution graph: from the start, follow the
+    marked (cheapest) connector of every expanded node. Only its tips, nodes not
+    expanded yet, are expanded; a tip is estimated by its own value, which never
+    exceeds its final cost. After an expansion the new cost is propagated upward
+    through the parent lists, and only to parents whose cost or solved flag
+    actually changes, so the parts of the graph the marked solution never leads
+    to are not touched. The search ends when the start is solved (its marked
+    connectors lead to goals only) or cannot be solved (infinite cost).
+
+    On a cycle, revisions would keep raising the costs around it a little at a
+    time (forever, if the cycle has no way out). When a node is revised too often
+    in one wave, the expanded nodes on cycles through it (its strongly connected
+    component) are settled exactly instead: nothing outside the component depends
+    on it, so Knuth's generalization of Dijkstra can fix its nodes cheapest first
+    from the costs around it, and nodes never fixed cannot be solved. evaluateAll
+    is the old full evaluation of the whole graph.
+
+    All per-node state is in flat arrays and bitsets indexed by node id and is
+    allocated once, in the constructor.
+*/
+class AOStarSearch
+{
+private:
+    static constexpr double INF = numeric_limits<double>::infinity();
+    static constexpr int MAX_REVISIONS = 16;
+
+    const AndOrGraph &graph;
+    uint32_t startNode;
+    vector<int> value; // starts as the graph's values; updateNodeValue changes it
+    vector<double> cost;
+    vector<int32_t> marked; // best connector: OR edge c, or hyperedge c - (number of OR edges)
+    Bitset generated, expanded, solved;
+    long long expansions = 0;
+
+    // Scratch, always left cleared
+    Bitset seen, seenAbove;
+    vector<int> revisions;
+    vector<uint8_t> region; // settle(): 1 = in the region, 2 = fixed
+    vector<uint32_t> stack;
+
+    uint32_t orCount(uint32_t node) const
+    {
+        return graph.orStart[node + 1] - graph.orStart[node];
+    }
+
+    uint32_t connectorCount(uint32_t node) const
+    {
+        return orCount(node) + graph.andStart[node + 1] - graph.andStart[node];
+    }
+
+    template <typename Visit>
+    void forEachChild(uint32_t node, uint32_t c, Visit visit) const
+    {
+        if (c < orCount(node))
+        {
+            visit(graph.orTarget[graph.orStart[node] + c]);
+            return;
         }
+        uint32_t edge = graph.andStart[node] + c - orCount(node);
+        for (uint32_t i = graph.edgeStart[edge]; i < graph.edgeStart[edge + 1]; i++)
+            visit(graph.andTarget[i]);
+    }
 
-        node->totalCost = minCost;
+    // Cost of reaching the goals through connector c, without the node's own value
+    double connectorCost(uint32_t node, uint32_t c) const
+    {
+        double total = c < orCount(node) ? graph.orCost[graph.orStart[node] + c]
+                                          : graph.edgeCost[graph.andStart[node] + c - orCount(node)];
+        forEachChild(node, c, [&](uint32_t child)
+                     { total += graph.obstacle.test(child) ? INF : cost[child]; });
+        return total;
     }
 
-public:
-    AOStarSearch(Node *start) : startNode(start)
+    bool connectorSolved(uint32_t node, uint32_t c) const
     {
-        graph[start->id] = start;
+        bool all = true;
+        forEachChild(node, c, [&](uint32_t child)
+                     { all = all && solved.test(child); });
+        return all;
     }
 
-    void addNode(Node *node)
+    void setSolved(uint32_t node, bool flag)
     {
-        graph[node->id] = node;
+        if (flag)
+            solved.set(node);
+        else
+            solved.reset(node);
+    }
+
+    // A node first seen by the search is estimated by its own value
+    void generate(uint32_t node)
+    {
+        if (generated.test(node))
+            return;
+        generated.set(node);
+        cost[node] = value[node];
+        setSolved(node, graph.goal.test(node));
     }
 
-    void addOREdge(const string &u, const string &v)
+    // Recomputes an expanded node from its connectors; returns whether its cost or solved flag changed
+    bool revise(uint32_t node)
     {
-        if (graph.count(u) && graph.count(v))
+        double oldCost = cost[node];
+        bool oldSolved = solved.test(node);
+        if (graph.goal.test(node))
         {
-            graph[u]->successors.push_back(graph[v]);
+            cost[node] = value[node];
+            solved.set(node);
         }
+        else
+        {
+            double best = INF;
+            marked[node] = -1;
+            for (uint32_t c = 0; c < connectorCount(node); c++)
+            {
+                double through = connectorCost(node, c);
+                if (through < best || (through == best && marked[node] != -1 && !connectorSolved(node, marked[node]) && connectorSolved(node, c)))
+                {
+                    best = through;
+                    marked[node] = c;
+                }
+            }
+            cost[node] = value[node] + best;
+            setSolved(node, marked[node] != -1 && best != INF && connectorSolved(node, marked[node]));
+        }
+        return cost[node] != oldCost || solved.test(node) != oldSolved;
     }
 
-    void addANDPair(const string &u, const string &v1, const string &v2)
+    /*
+        Exact costs for a set of expanded nodes, given the costs of all other
+        nodes: each node's cost can only come from connectors whose children are
+        outside the set or already fixed, and the cheapest such node is fixed next
+        (costs never drop below a child's, so this is Dijkstra's argument).
+    */
+    void settle(const vector<uint32_t> &members)
     {
-        if (graph.count(u) && graph.count(v1) && graph.count(v2))
+        auto usable = [&](uint32_t node, uint32_t c)
+        {
+            bool ready = true;
+            forEachChild(node, c, [&](uint32_t child)
+                         { ready = ready && region[child] != 1; });
+            return ready;
+        };
+        auto candidate = [&](uint32_t node)
+        {
+            double best = INF;
+            for (uint32_t c = 0; c < connectorCount(node); c++)
+                if (usable(node, c))
+                    best = min(best, value[node] + connectorCost(node, c));
+            return best;
+        };
+
+        for (uint32_t node : members)
+        {
+            region[node] = 1;
+            cost[node] = INF;
+            solved.reset(node);
+            marked[node] = -1;
+        }
+        priority_queue<pair<double, uint32_t>, vector<pair<double, uint32_t>>, greater<pair<double, uint32_t>>> heap;
+        for (uint32_t node : members)
         {
-            graph[u]->andPairs.push_back({graph[v1], graph[v2]});
+            double through = candidate(node);
+            if (through != INF)
+                heap.push({through, node});
+        }
+        while (!heap.empty())
+        {
+            uint32_t node = heap.top().second;
+            heap.pop();
+            if (region[node] != 1)
+                continue;
+            region[node] = 2;
+            revise(node); // every connector it could use is final now
+            for (uint32_t i = graph.parentStart[node]; i < graph.parentStart[node + 1]; i++)
+            {
+                uint32_t parent = graph.parent[i];
+                if (region[parent] != 1)
+                    continue;
+                double through = candidate(parent);
+                if (through != INF)
+                    heap.push({through, parent});
+            }
+        }
+        // Whatever is left only reaches the goals through itself
+        for (uint32_t node : members)
+        {
+            if (region[node] == 1)
+                cost[node] = INF;
+            region[node] = 0;
         }
     }
 
-    vector<string> findPath()
+    // Expanded nodes that lie on a cycle through `node` (reachable from it and reaching it)
+    vector<uint32_t> cycleAround(uint32_t node)
     {
-        vector<string> path;
-        set<string> visited;
+        vector<uint32_t> below = {node};
+        seen.set(node);
+        stack.assign(1, node);
+        while (!stack.empty())
+        {
+            uint32_t current = stack.back();
+            stack.pop_back();
+            for (uint32_t c = 0; c < connectorCount(current); c++)
+                forEachChild(current, c, [&](uint32_t child)
+                             {
+                    if (expanded.test(child) && !seen.test(child))
+                    {
+                        seen.set(child);
+                        below.push_back(child);
+                        stack.push_back(child);
+                    } });
+        }
 
-        // Initial evaluation
-        evaluateNode(startNode, visited);
-        visited.clear();
+        vector<uint32_t> component = {node};
+        seenAbove.set(node);
+        stack.assign(1, node);
+        while (!stack.empty())
+        {
+            uint32_t current = stack.back();
+            stack.pop_back();
+            for (uint32_t i = graph.parentStart[current]; i < graph.parentStart[current + 1]; i++)
+            {
+                uint32_t parent = graph.parent[i];
+                if (expanded.test(parent) && seen.test(parent) && !seenAbove.test(parent))
+                {
+                    seenAbove.set(parent);
+                    component.push_back(parent);
+                    stack.push_back(parent);
+                }
+            }
+        }
+        for (uint32_t member : below)
+            seen.reset(member);
+        for (uint32_t member : component)
+            seenAbove.reset(member);
+        return component;
+    }
 
-        // Trace the path
-        Node *current = startNode;
-        while (current && !visited.count(current->id))
+    // Passes a change at `from` up to the parents it affects
+    void propagate(uint32_t from)
+    {
+        vector<uint32_t> changed = {from}, revised;
+        while (!changed.empty())
         {
-            path.push_back(current->id);
-            visited.insert(current->id);
+            uint32_t node = changed.back();
+            changed.pop_back();
+            for (uint32_t i = graph.parentStart[node]; i < graph.parentStart[node + 1]; i++)
+            {
+                uint32_t parent = graph.parent[i];
+                if (!expanded.test(parent) || !revise(parent))
+                    continue;
+                if (revisions[parent]++ == 0)
+                    revised.push_back(parent);
+                if (revisions[parent] <= MAX_REVISIONS)
+                {
+                    changed.push_back(parent);
+                    continue;
+                }
 
-            if (current->isGoal)
+                // Probably a cycle: settle the component, then carry on above it
+                vector<uint32_t> members = cycleAround(parent);
+                settle(members);
+                for (uint32_t member : members)
+                    region[member] = 1;
+                for (uint32_t member : members)
+                {
+                    revisions[member] = 0;
+                    for (uint32_t j = graph.parentStart[member]; j < graph.parentStart[member + 1]; j++)
+                    {
+                        uint32_t above = graph.parent[j];
+                        if (expanded.test(above) && region[above] == 0 && revise(above))
+                            changed.push_back(above);
+                    }
+                }
+                for (uint32_t member : members)
+                    region[member] = 0;
+            }
+        }
+        for (uint32_t node : revised)
+            revisions[node] = 0;
+    }
+
+    void expand(uint32_t node)
+    {
+        expanded.set(node);
+        expansions++;
+        for (uint32_t c = 0; c < connectorCount(node); c++)
+            forEachChild(node, c, [&](uint32_t child)
+                         { generate(child); });
+        revise(node);
+        propagate(node);
+    }
+
+    // Unexpanded, unsolved nodes of the marked partial solution graph
+    vector<uint32_t> tips()
+    {
+        vector<uint32_t> found, visited = {startNode};
+        seen.set(startNode);
+        stack.assign(1, startNode);
+        while (!stack.empty())
+        {
+            uint32_t node = stack.back();
+            stack.pop_back();
+            if (solved.test(node))
+                continue;
+            if (!expanded.test(node))
+            {
+                found.push_back(node);
+                continue;
+            }
+            if (marked[node] == -1)
+                continue;
+            forEachChild(node, marked[node], [&](uint32_t child)
+                         {
+                if (!seen.test(child))
+                {
+                    seen.set(child);
+                    visited.push_back(child);
+                    stack.push_back(child);
+                } });
+        }
+        for (uint32_t node : visited)
+            seen.reset(node);
+        return found;
+    }
+
+    void search()
+    {
+        generate(startNode);
+        while (!solved.test(startNode) && cost[startNode] != INF)
+        {
+            vector<uint32_t> open = tips();
+            if (open.empty())
                 break;
+            for (uint32_t tip : open)
+                if (!expanded.test(tip))
+                    expand(tip);
+        }
+    }
+
+    // Children over all connectors, OR edges first (a child may appear more than once)
+    uint32_t childCount(uint32_t node) const
+    {
+        return orCount(node) + graph.edgeStart[graph.andStart[node + 1]] - graph.edgeStart[graph.andStart[node]];
+    }
+
+    uint32_t child(uint32_t node, uint32_t i) const
+    {
+        return i < orCount(node) ? graph.orTarget[graph.orStart[node] + i]
+                                 : graph.andTarget[graph.edgeStart[graph.andStart[node]] + i - orCount(node)];
+    }
 
-            // Find next node
-            Node *next = NULL;
-            double minCost = numeric_limits<double>::infinity();
+    /*
+        Evaluates the nodes for which pending() holds, given final costs for every
+        other node, and calls finish() on each once it is final. Tarjan's algorithm,
+        run with an explicit stack, finds their strongly connected components in
+        reverse topological order, so all children outside a component are final
+        when it is reached. A single node is evaluated directly (with positive edge
+        costs a self-loop never helps); a larger component is settled exactly by
+        settle(). Linear in the pending part of the graph apart from settle's heap.
+    */
+    template <typename Pending, typename Finish>
+    void evaluateCycles(Pending pending, Finish finish)
+    {
+        uint32_t n = graph.size(), first = 0;
+        while (first < n && !pending(first))
+            first++;
+        if (first == n)
+            return;
+
+        struct Frame
+        {
+            uint32_t node, next; // next child to look at
+        };
+        vector<uint32_t> order(n, 0), low(n, 0), members;
+        vector<Frame> frames;
+        Bitset onStack;
+        onStack.resize(n);
+        uint32_t counter = 0;
 
-            // Check regular successors
-            for (auto &successor : current->successors)
+        for (uint32_t root = first; root < n; root++)
+        {
+            if (order[root] != 0 || !pending(root))
+                continue;
+            order[root] = low[root] = ++counter;
+            members.push_back(root);
+            onStack.set(root);
+            frames.push_back({root, 0});
+            while (!frames.empty())
             {
-                if (!successor->isObstacle && !visited.count(successor->id))
+                Frame &frame = frames.back();
+                uint32_t node = frame.node;
+                if (frame.next < childCount(node))
                 {
-                    if (successor->totalCost + 1 < minCost)
+                    uint32_t next = child(node, frame.next++);
+                    if (graph.obstacle.test(next) || !pending(next))
+                        continue;
+                    if (order[next] == 0)
                     {
-                        minCost = successor->totalCost + 1;
-                        next = successor;
+                        order[next] = low[next] = ++counter;
+                        members.push_back(next);
+                        onStack.set(next);
+                        frames.push_back({next, 0}); // invalidates frame
                     }
+                    else if (onStack.test(next))
+                        low[node] = min(low[node], order[next]);
+                    continue;
                 }
+
+                frames.pop_back();
+                if (!frames.empty())
+                    low[frames.back().node] = min(low[frames.back().node], low[node]);
+                if (low[node] != order[node])
+                    continue;
+
+                // node is the root of a component: the members above it on the stack
+                size_t begin = members.size();
+                do
+                    onStack.reset(members[--begin]);
+                while (members[begin] != node);
+                if (begin + 1 == members.size())
+                    cost[node] = evaluate(node);
+                else
+                    settle(vector<uint32_t>(members.begin() + begin, members.end()));
+                for (size_t i = begin; i < members.size(); i++)
+                    finish(members[i]);
+                members.resize(begin);
             }
+        }
+    }
+
+    // Cost of a node whose children all have their final costs
+    double evaluate(uint32_t node) const
+    {
+        if (graph.goal.test(node))
+            return value[node];
+        double minCost = INF;
+        for (uint32_t c = 0; c < connectorCount(node); c++)
+            minCost = min(minCost, value[node] + connectorCost(node, c));
+        return minCost;
+    }
+
+public:
+    AOStarSearch(const AndOrGraph &graph, const string &start)
+        : graph(graph), startNode(graph.id(start)), value(graph.value),
+          cost(graph.size(), INF), marked(graph.size(), -1),
+          revisions(graph.size(), 0), region(graph.size(), 0)
+    {
+        if (startNode == UINT32_MAX)
+            throw invalid_argument("unknown start node " + start);
+        generated.resize(graph.size());
+        expanded.resize(graph.size());
+        solved.resize(graph.size());
+        seen.resize(graph.size());
+        seenAbove.resize(graph.size());
+    }
 
-            // Check AND pairs
-            for (const auto &andPair : current->andPairs)
+    /*
+        Changes the value of a node after (or before) a search; the change is
+        propagated to the ancestors it affects and the next findPath continues
+        from the revised costs.
+    */
+    void updateNodeValue(const string &label, int newValue)
+    {
+        uint32_t node = graph.id(label);
+        if (node == UINT32_MAX)
+            return;
+        value[node] = newValue;
+        if (!generated.test(node))
+            return;
+        if (expanded.test(node) || graph.goal.test(node))
+            revise(node);
+        else
+            cost[node] = newValue;
+        propagate(node);
+    }
+
+    // Nodes expanded by the incremental search so far
+    long long expandedNodes() const
+    {
+        return expansions;
+    }
+
+    double costOf(const string &label) const
+    {
+        uint32_t node = graph.id(label);
+        return node == UINT32_MAX ? INF : cost[node];
+    }
+
+    /*
+        Full bottom-up evaluation of every node reachable from the start, on
+        nThreads workers (0 = one per core); overwrites the costs.
+
+        The first pass walks down from the start in parallel and counts the
+        distinct children each node waits for (goals wait for none). The second
+        pass starts from the nodes waiting for nothing; a finished node is never
+        waited on by a blocked thread, it just counts down its parents through the
+        parent lists and hands on the ones it completes. So every shared sub-DAG is
+        evaluated once, and the children of a connector are evaluated on whichever
+        workers are free.
+
+        Nodes on a cycle, and the nodes above them, never complete. They are
+        finished by evaluateCycles.
+    */
+    void evaluateAll(int nThreads = 0)
+    {
+        if (nThreads <= 0)
+            nThreads = max(1u, thread::hardware_concurrency());
+        uint32_t n = graph.size();
+        vector<atomic<uint8_t>> reached(n);
+        vector<atomic<uint32_t>> waiting(n); // children not evaluated yet
+        vector<vector<uint32_t>> ready(nThreads), children(nThreads);
+
+        // Every new child but the first is left for any worker; the first is walked on this one
+        NodeQueues discover(nThreads);
+        reached[startNode] = 1;
+        discover.push(0, startNode);
+        discover.run([&](unsigned id, uint32_t node)
+                     {
+            while (node != UINT32_MAX)
             {
-                if (!andPair.first->isObstacle && !andPair.second->isObstacle)
+                cost[node] = INF;
+                vector<uint32_t> &distinct = children[id];
+                distinct.clear();
+                if (!graph.goal.test(node))
+                    for (uint32_t c = 0; c < connectorCount(node); c++)
+                        forEachChild(node, c, [&](uint32_t child)
+                                     {
+                            if (!graph.obstacle.test(child) && find(distinct.begin(), distinct.end(), child) == distinct.end())
+                                distinct.push_back(child); });
+                waiting[node].store(distinct.size(), memory_order_relaxed);
+                if (distinct.empty())
+                    ready[id].push_back(node);
+
+                node = UINT32_MAX;
+                for (uint32_t child : distinct)
                 {
-                    double pairCost = andPair.first->totalCost + andPair.second->totalCost + 2;
-                    if (pairCost < minCost)
-                    {
-                        minCost = pairCost;
-                        // Choose the unvisited node with lower cost
-                        if (!visited.count(andPair.first->id) &&
-                            (!visited.count(andPair.second->id) && andPair.first->totalCost <= andPair.second->totalCost))
-                        {
-                            next = andPair.first;
-                        }
-                        else if (!visited.count(andPair.second->id))
-                        {
-                            next = andPair.second;
-                        }
-                    }
+                    if (reached[child].load(memory_order_relaxed) || reached[child].exchange(1, memory_order_relaxed))
+                        continue;
+                    if (node == UINT32_MAX)
+                        node = child;
+                    else
+                        discover.push(id, child);
                 }
-            }
+            } });
 
-            current = next;
-        }
+        // Likewise every completed parent but the first is left for any worker
+        NodeQueues evaluation(nThreads);
+        for (int id = 0; id < nThreads; id++)
+            for (uint32_t node : ready[id])
+                evaluation.push(id, node);
+        evaluation.run([&](unsigned id, uint32_t node)
+                       {
+            while (node != UINT32_MAX)
+            {
+                cost[node] = evaluate(node);
+                if (graph.obstacle.test(node))
+                    return; // only the start can be reached as an obstacle, and nothing counts it
+                uint32_t done = node;
+                node = UINT32_MAX;
+                for (uint32_t i = graph.parentStart[done]; i < graph.parentStart[done + 1]; i++)
+                {
+                    uint32_t parent = graph.parent[i];
+                    if (!reached[parent].load(memory_order_relaxed) || graph.goal.test(parent) ||
+                        waiting[parent].fetch_sub(1, memory_order_acq_rel) != 1)
+                        continue;
+                    if (node == UINT32_MAX)
+                        node = parent;
+                    else
+                        evaluation.push(id, parent);
+                }
+            } });
 
-        return path;
+        evaluateCycles([&](uint32_t node)
+                       { return reached[node].load(memory_order_relaxed) && waiting[node].load(memory_order_relaxed) > 0; },
+                       [&](uint32_t node)
+                       { waiting[node].store(0, memory_order_relaxed); });
     }
 
-    void printCosts()
+    /*
+        Runs the incremental search and returns the solution graph in preorder
+        (each node once), or an empty path if the start cannot be solved.
+    */
+    vector<string> findPath()
     {
-        cout << "Final Node costs:\n";
-        for (const auto &[id, node] : graph)
+        search();
+        vector<string> path;
+        if (!solved.test(startNode))
+            return path;
+
+        vector<uint32_t> visited = {startNode}, children;
+        seen.set(startNode);
+        stack.assign(1, startNode);
+        while (!stack.empty())
         {
-            cout << id << ": " << node->totalCost << "\n";
+            uint32_t current = stack.back();
+            stack.pop_back();
+            path.push_back(graph.label(current));
+            if (graph.goal.test(current) || marked[current] == -1)
+                continue;
+
+            // Push in reverse so the children come out in connector order
+            children.clear();
+            forEachChild(current, marked[current], [&](uint32_t child)
+                         {
+                if (!seen.test(child))
+                {
+                    seen.set(child);
+                    visited.push_back(child);
+                    children.push_back(child);
+                } });
+            for (int i = children.size() - 1; i >= 0; i--)
+                stack.push_back(children[i]);
         }
+        for (uint32_t node : visited)
+            seen.reset(node);
+
+        return path;
     }
 
-    ~AOStarSearch()
+    void printCosts()
     {
-        for (auto &[id, node] : graph)
+        cout << "Final Node costs:\n";
+        for (uint32_t node = 0; node < graph.size(); node++)
         {
-            delete node;
+            cout << graph.label(node) << ": " << cost[node] << "\n";
         }
     }
 };
 
-int main()
+// Peak resident set size of this process in KB
+long peakMemoryKB()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/*
+    Generates graphs of growing size and reports how long building, the full
+    evaluation and the incremental search take, and how much memory they use.
+*/
+void runBenchmark(uint32_t maxNodes, unsigned seed)
 {
-    Node *nodeA = new Node("A", 0);
-    Node *nodeB = new Node("B", 4);
-    Node *nodeC = new Node("C", 0, false, true);
-    Node *nodeD = new Node("D", 10);
-    Node *nodeE = new Node("E", 3);
-    Node *nodeF = new Node("F", 0, false, true);
-    Node *nodeG = new Node("G", 0, false, true);
-    Node *nodeH = new Node("H", 2);
-    Node *nodeI = new Node("I", 8);
-    Node *nodeJ = new Node("J", 0, false, true);
-    Node *nodeK = new Node("K", 3);
-    Node *nodeL = new Node("L", 5, true);
+    unsigned cores = max(1u, thread::hardware_concurrency());
+    cout << "Full evaluation on 1 and " << cores << " threads\n";
+    cout << setw(10) << "nodes" << setw(12) << "connectors" << setw(10) << "build ms" << setw(10) << "eval 1"
+         << setw(10) << "eval " + to_string(cores) << setw(10) << "AO* ms" << setw(10) << "expanded" << setw(12) << "start cost" << setw(10) << "graph MB"
+         << setw(10) << "peak MB" << "\n";
+    for (uint32_t nodes = 10000; nodes <= maxNodes; nodes *= 4)
+    {
+        GeneratorOptions options;
+        options.nodes = nodes;
+        options.layers = max<uint32_t>(10, sqrt(nodes)); // depth and width both grow
+        options.seed = seed;
+
+        auto begin = chrono::steady_clock::now();
+        AndOrGraph graph = generateAndOrGraph(options);
+        auto built = chrono::steady_clock::now();
+
+        AOStarSearch serial(graph, "S");
+        serial.evaluateAll(1);
+        auto evaluatedSerial = chrono::steady_clock::now();
+
+        AOStarSearch full(graph, "S");
+        full.evaluateAll(cores);
+        auto evaluated = chrono::steady_clock::now();
 
-    AOStarSearch search(nodeA);
+        AOStarSearch incremental(graph, "S");
+        incremental.findPath();
+        auto searched = chrono::steady_clock::now();
 
-    vector<Node *> nodes = {nodeA, nodeB, nodeC, nodeD, nodeE, nodeF,
-                            nodeG, nodeH, nodeI, nodeJ, nodeK, nodeL};
-    for (const auto &node : nodes)
+        auto ms = [](auto from, auto to)
+        {
+            return chrono::duration<double, milli>(to - from).count();
+        };
+        size_t connectors = graph.orTarget.size() + graph.edgeCost.size();
+        cout << fixed << setprecision(1) << setw(10) << graph.size() << setw(12) << connectors << setw(10)
+             << ms(begin, built) << setw(10) << ms(built, evaluatedSerial) << setw(10) << ms(evaluatedSerial, evaluated) << setw(10) << ms(evaluated, searched)
+             << setw(10) << incremental.expandedNodes() << setw(12) << incremental.costOf("S") << setw(10)
+             << graph.memoryBytes() / 1048576.0 << setw(10) << peakMemoryKB() / 1024.0 << "\n";
+        if (full.costOf("S") != incremental.costOf("S"))
+            cout << "  evaluateAll and AO* disagree: " << full.costOf("S") << " vs " << incremental.costOf("S") << "\n";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && string(argv[1]) == "--bench")
     {
-        search.addNode(node);
+        // --bench [maxNodes] [seed]
+        uint32_t maxNodes = argc > 2 ? atol(argv[2]) : 2560000;
+        unsigned seed = argc > 3 ? atoi(argv[3]) : 1;
+        runBenchmark(maxNodes, seed);
+        return 0;
     }
 
+    AndOrGraphBuilder builder;
+    builder.addNode("A", 0);
+    builder.addNode("B", 4);
+    builder.addNode("C", 0, false, true);
+    builder.addNode("D", 10);
+    builder.addNode("E", 3);
+    builder.addNode("F", 0, false, true);
+    builder.addNode("G", 0, false, true);
+    builder.addNode("H", 2);
+    builder.addNode("I", 8);
+    builder.addNode("J", 0, false, true);
+    builder.addNode("K", 3);
+    builder.addNode("L", 5, true);
+
     // OR edges
-    search.addOREdge("A", "B");
-    search.addOREdge("A", "D");
-    search.addOREdge("A", "E");
-    search.addOREdge("B", "H");
-    search.addOREdge("B", "K");
-    search.addOREdge("E", "H");
-    search.addOREdge("E", "K");
-    search.addOREdge("H", "I");
-    search.addOREdge("K", "L");
-    search.addOREdge("I", "L");
+    builder.addOREdge("A", "B");
+    builder.addOREdge("A", "D");
+    builder.addOREdge("A", "E");
+    builder.addOREdge("B", "H");
+    builder.addOREdge("B", "K");
+    builder.addOREdge("E", "H");
+    builder.addOREdge("E", "K");
+    builder.addOREdge("H", "I");
+    builder.addOREdge("K", "L");
+    builder.addOREdge("I", "L");
 
     // AND pairs    ---> HyperEdges
-    search.addANDPair("A", "B", "E");
-    search.addANDPair("B", "H", "K");
-    search.addANDPair("E", "H", "K");
+    builder.addANDPair("A", "B", "E");
+    builder.addANDPair("B", "H", "K");
+    builder.addANDPair("E", "H", "K");
 
+    AndOrGraph graph = builder.freeze();
+    AOStarSearch search(graph, "A");
     vector<string> path = search.findPath();
+    if (path.empty())
+    {
+        cout << "No solution\n";
+        return 0;
+    }
 
-    cout << "Optimal path: ";
+    cout << "Solution graph: ";
     for (int i = 0; i < path.size(); ++i)
     {
         cout << path[i];
@@ -231,6 +1178,7 @@ int main()
     cout << "\n";
 
     search.printCosts();
+    cout << "Nodes expanded: " << search.expandedNodes() << "\n";
 
     return 0;
 }
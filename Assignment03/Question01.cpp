@@ -12,23 +12,106 @@ struct Coord
     }
 };
 
-// For hashing
-string makeKey(const Coord &coord, int mask)
+/*
+    Best cost found so far for each search state, keyed by the packed state
+    (cellIndex << nGoals) | mask. When the whole state space is small enough it
+    is a flat array indexed by the key; otherwise only the states actually
+    reached are kept, in an open-addressing hash table with linear probing.
+*/
+class StateCosts
 {
-    ostringstream oss;
-    oss << coord.x << "," << coord.y << "," << coord.z << "," << mask;
-    return oss.str();
-}
+private:
+    static constexpr uint64_t EMPTY = UINT64_MAX;
+    static constexpr uint64_t FLAT_LIMIT = 1 << 24; // states (128 MB of doubles)
+
+    bool flat;
+    vector<double> costs; // flat: indexed by key; hashed: parallel to keys
+    vector<uint64_t> keys;
+    size_t used = 0;
+    int bits = 0;
+
+    size_t slot(uint64_t key) const
+    {
+        return (key * 0x9E3779B97F4A7C15ULL) >> (64 - bits);
+    }
+
+    void rehash(int newBits)
+    {
+        vector<uint64_t> oldKeys(1ULL << newBits, EMPTY);
+        vector<double> oldCosts(1ULL << newBits);
+        oldKeys.swap(keys);
+        oldCosts.swap(costs);
+        bits = newBits;
+        for (size_t i = 0; i < oldKeys.size(); i++)
+        {
+            if (oldKeys[i] == EMPTY)
+                continue;
+            size_t at = slot(oldKeys[i]);
+            while (keys[at] != EMPTY)
+                at = (at + 1) & (keys.size() - 1);
+            keys[at] = oldKeys[i];
+            costs[at] = oldCosts[i];
+        }
+    }
 
-// Node struct
+public:
+    StateCosts(uint64_t states) : flat(states <= FLAT_LIMIT)
+    {
+        if (flat)
+            costs.assign(states, numeric_limits<double>::infinity());
+        else
+            rehash(16);
+    }
+
+    double get(uint64_t key) const
+    {
+        if (flat)
+            return costs[key];
+        for (size_t at = slot(key);; at = (at + 1) & (keys.size() - 1))
+        {
+            if (keys[at] == key)
+                return costs[at];
+            if (keys[at] == EMPTY)
+                return numeric_limits<double>::infinity();
+        }
+    }
+
+    void set(uint64_t key, double cost)
+    {
+        if (flat)
+        {
+            costs[key] = cost;
+            return;
+        }
+        if (2 * (used + 1) > keys.size()) // at most half full
+            rehash(bits + 1);
+        size_t at = slot(key);
+        while (keys[at] != EMPTY && keys[at] != key)
+            at = (at + 1) & (keys.size() - 1);
+        if (keys[at] == EMPTY)
+        {
+            keys[at] = key;
+            used++;
+        }
+        costs[at] = cost;
+    }
+};
+
+// Node struct, kept in an arena; the path is rebuilt through the parent indices
 struct Node
 {
-    Coord coord;        // current coordinate (x, y, z)
-    int mask;           // bitmask indicating which rescue goals have been visited
-    double g, h, f;     // g: cost so far, h: heuristic, f: total cost
-    vector<Coord> path; // full 3D path (list of coordinates)
+    Coord coord; // current coordinate (x, y, z)
+    int mask;    // bitmask indicating which rescue goals have been visited
+    int parent;  // arena index of the previous node, -1 at the start
+};
+
+// Open list entry: f, g and the arena index of the node
+struct OpenEntry
+{
+    double f, g; // f: total cost, g: cost so far
+    int node;
 
-    bool operator>(const Node &other) const
+    bool operator>(const OpenEntry &other) const
     {
         return f > other.f;
     }
@@ -41,11 +124,32 @@ private:
     vector<Coord> rescueGoals;
     Coord base;
     int nGoals;
+    int sizeX, sizeY, sizeZ;
+    vector<int> goalsAt; // bitmask of the goals in each cell
+
+    vector<double> pointDistance;  // distances between the goals and the base (index nGoals)
+    vector<double> spanningWeight; // spanningTree(mask) for every mask, once built
 
     int dx[6] = {-1, 1, 0, 0, 0, 0};
     int dy[6] = {0, 0, -1, 1, 0, 0};
     int dz[6] = {0, 0, 0, 0, -1, 1};
 
+    int cellIndex(const Coord &c) const
+    {
+        return (c.x * sizeY + c.y) * sizeZ + c.z;
+    }
+
+    uint64_t stateKey(const Coord &c, int mask) const
+    {
+        return (uint64_t)cellIndex(c) << nGoals | mask;
+    }
+
+    // Mask after entering cell c
+    int enter(const Coord &c, int mask) const
+    {
+        return mask | goalsAt[cellIndex(c)];
+    }
+
     double euclidean(const Coord &a, const Coord &b)
     {
         return sqrt(pow(a.x - b.x, 2) +
@@ -53,28 +157,68 @@ private:
                     pow(a.z - b.z, 2));
     }
 
-    // Multi-goal heuristic:
-    // If not all rescue goals are visited, h = distance(current, nearest unvisited goal) + distance(nearest goal, base)
-    // Otherwise, h = distance(current, base)
-    double heuristic(const Coord &current, int mask)
+    // Weight of the minimum spanning tree (Prim) over the goals not in mask and the base
+    double spanningTree(int mask) const
     {
-        if (mask == (1 << nGoals) - 1)
-            return euclidean(current, base);
-        double best = numeric_limits<double>::max();
-        double bestToBase = 0.0;
+        vector<int> points = {nGoals}; // the base is point nGoals
         for (int i = 0; i < nGoals; i++)
-        {
             if (!(mask & (1 << i)))
-            {
-                double d = euclidean(current, rescueGoals[i]);
-                if (d < best)
-                {
-                    best = d;
-                    bestToBase = euclidean(rescueGoals[i], base);
-                }
-            }
+                points.push_back(i);
+        int k = points.size();
+        vector<double> link(k, numeric_limits<double>::infinity());
+        vector<char> inTree(k, 0);
+        link[0] = 0;
+        double weight = 0;
+        for (int step = 0; step < k; step++)
+        {
+            int next = -1;
+            for (int i = 0; i < k; i++)
+                if (!inTree[i] && (next == -1 || link[i] < link[next]))
+                    next = i;
+            inTree[next] = 1;
+            weight += link[next];
+            for (int i = 0; i < k; i++)
+                if (!inTree[i])
+                    link[i] = min(link[i], pointDistance[points[next] * (nGoals + 1) + points[i]]);
         }
-        return best + bestToBase;
+        return weight;
+    }
+
+    // Tree weights of every mask, filled by nThreads workers over interleaved masks
+    void buildSpanningWeights(int nThreads)
+    {
+        spanningWeight.assign(1 << nGoals, 0);
+        if (nThreads <= 0)
+            nThreads = max(1u, thread::hardware_concurrency());
+        nThreads = min(nThreads, 1 << nGoals);
+        auto worker = [&](int id)
+        {
+            for (int mask = id; mask < (1 << nGoals); mask += nThreads)
+                spanningWeight[mask] = spanningTree(mask);
+        };
+        vector<thread> threads;
+        for (int id = 1; id < nThreads; id++)
+            threads.emplace_back(worker, id);
+        worker(0);
+        for (thread &t : threads)
+            t.join();
+    }
+
+    /*
+        Multi-goal heuristic: the weight of a minimum spanning tree over the
+        unvisited goals and the base, plus the distance from the current cell to
+        the nearest of them. The rest of any mission leaves the current cell for
+        one of these points first and then passes through all of them, so it is at
+        least that long (every move costs at least 1 and covers a distance of 1).
+        Tree weights come from the per-mask table when there is one.
+    */
+    double heuristic(const Coord &current, int mask)
+    {
+        double connect = euclidean(current, base);
+        for (int i = 0; i < nGoals; i++)
+            if (!(mask & (1 << i)))
+                connect = min(connect, euclidean(current, rescueGoals[i]));
+        return connect + (spanningWeight.empty() ? spanningTree(mask) : spanningWeight[mask]);
     }
 
     // For free space cost is 1, fire cost is 3.
@@ -90,42 +234,99 @@ private:
             return baseCost;
     }
 
+    Coord cellCoord(int cell) const
+    {
+        return {cell / (sizeY * sizeZ), cell / sizeZ % sizeY, cell % sizeZ};
+    }
+
+    // Dijkstra from `source` over the cells: dist[c] = cheapest cost to enter c, parent[c] = previous cell (-1 at the source)
+    void shortestPaths(const Coord &source, vector<int> &dist, vector<int> &parent)
+    {
+        dist.assign(sizeX * sizeY * sizeZ, INT_MAX);
+        parent.assign(sizeX * sizeY * sizeZ, -1);
+        priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq;
+        dist[cellIndex(source)] = 0;
+        pq.push({0, cellIndex(source)});
+        while (!pq.empty())
+        {
+            auto [d, cell] = pq.top();
+            pq.pop();
+            if (d > dist[cell])
+                continue;
+            Coord current = cellCoord(cell);
+            for (int i = 0; i < 6; i++)
+            {
+                Coord next{current.x + dx[i], current.y + dy[i], current.z + dz[i]};
+                if (next.x < 0 || next.y < 0 || next.z < 0 || next.x >= sizeX || next.y >= sizeY || next.z >= sizeZ)
+                    continue;
+                if (grid[next.x][next.y][next.z] == '1')
+                    continue;
+                int nextCell = cellIndex(next);
+                int dNew = d + getCost(grid[next.x][next.y][next.z], dz[i]);
+                if (dNew < dist[nextCell])
+                {
+                    dist[nextCell] = dNew;
+                    parent[nextCell] = cell;
+                    pq.push({dNew, nextCell});
+                }
+            }
+        }
+    }
+
 public:
     AStarDrone(vector<vector<vector<char>>> cityGrid, vector<Coord> rescueGoals, Coord base)
         : grid(cityGrid), rescueGoals(rescueGoals), base(base)
     {
         nGoals = rescueGoals.size();
+        sizeX = grid.size();
+        sizeY = sizeX ? grid[0].size() : 0;
+        sizeZ = sizeY ? grid[0][0].size() : 0;
+        goalsAt.assign(sizeX * sizeY * sizeZ, 0);
+        for (int i = 0; i < nGoals; i++)
+            goalsAt[cellIndex(rescueGoals[i])] |= 1 << i;
+
+        pointDistance.resize((nGoals + 1) * (nGoals + 1));
+        for (int i = 0; i <= nGoals; i++)
+            for (int j = 0; j <= nGoals; j++)
+                pointDistance[i * (nGoals + 1) + j] = euclidean(i == nGoals ? base : rescueGoals[i], j == nGoals ? base : rescueGoals[j]);
     }
 
+    // Past this many goals the tree weights are computed per lookup instead of tabled
+    static const int MAX_SPANNING_TABLE_GOALS = 20;
+
     // Returns a pair: (path, totalEnergyCost). An empty path indicates failure.
     pair<vector<Coord>, double> findPath(Coord start)
     {
-        priority_queue<Node, vector<Node>, greater<Node>> pq;
-        unordered_map<string, double> visited; // state key -> best f cost
+        if (spanningWeight.empty() && nGoals <= MAX_SPANNING_TABLE_GOALS)
+            buildSpanningWeights(0);
+        priority_queue<OpenEntry, vector<OpenEntry>, greater<OpenEntry>> pq;
+        vector<Node> nodes;                                         // every node ever pushed
+        StateCosts best((uint64_t)sizeX * sizeY * sizeZ << nGoals); // state key -> best g
 
-        // Start state: no rescue goals visited.
-        Node startNode{start, 0, 0.0, heuristic(start, 0), heuristic(start, 0), {start}};
-        pq.push(startNode);
+        // Start state: only a goal under the start is visited.
+        int startMask = enter(start, 0);
+        nodes.push_back({start, startMask, -1});
+        best.set(stateKey(start, startMask), 0.0);
+        pq.push({heuristic(start, startMask), 0.0, 0});
 
         while (!pq.empty())
         {
-            Node current = pq.top();
+            OpenEntry entry = pq.top();
             pq.pop();
+            Node current = nodes[entry.node];
 
-            string key = makeKey(current.coord, current.mask);
-            if (visited.find(key) != visited.end() && visited[key] <= current.f)
+            // A cheaper way to this state was found after this one was pushed
+            if (entry.g > best.get(stateKey(current.coord, current.mask)))
                 continue;
-            visited[key] = current.f;
 
-            for (int i = 0; i < nGoals; i++)
+            if (current.mask == (1 << nGoals) - 1 && current.coord == base)
             {
-                if (!(current.mask & (1 << i)) && current.coord == rescueGoals[i])
-                {
-                    current.mask |= (1 << i);
-                }
+                vector<Coord> path;
+                for (int at = entry.node; at != -1; at = nodes[at].parent)
+                    path.push_back(nodes[at].coord);
+                reverse(path.begin(), path.end());
+                return {path, entry.g};
             }
-            if (current.mask == (1 << nGoals) - 1 && current.coord == base)
-                return {current.path, current.g};
 
             for (int i = 0; i < 6; i++)
             {
@@ -134,30 +335,159 @@ public:
                            current.coord.z + dz[i]};
 
                 if (next.x < 0 || next.y < 0 || next.z < 0 ||
-                    next.x >= grid.size() ||
-                    next.y >= grid[0].size() ||
-                    next.z >= grid[0][0].size())
+                    next.x >= sizeX ||
+                    next.y >= sizeY ||
+                    next.z >= sizeZ)
                     continue;
                 if (grid[next.x][next.y][next.z] == '1')
                     continue;
 
                 int moveCost = getCost(grid[next.x][next.y][next.z], dz[i]);
-                double gNew = current.g + moveCost;
-                double hNew = heuristic(next, current.mask);
-                double fNew = gNew + hNew;
+                double gNew = entry.g + moveCost;
+                int nextMask = enter(next, current.mask);
+                uint64_t nKey = stateKey(next, nextMask);
+                if (gNew >= best.get(nKey))
+                    continue;
+                best.set(nKey, gNew);
+
+                nodes.push_back({next, nextMask, entry.node});
+                pq.push({gNew + heuristic(next, nextMask), gNew, (int)nodes.size() - 1});
+            }
+        }
+        return {{}, 0.0};
+    }
 
-                vector<Coord> newPath = current.path;
-                newPath.push_back(next);
+    /*
+        Two-phase planner for missions with many rescue goals, where the joint
+        search over cells x 2^nGoals states blows up. It returns the same cost.
 
-                Node neighbor{next, current.mask, gNew, hNew, fNew, newPath};
-                string nKey = makeKey(neighbor.coord, neighbor.mask);
-                if (visited.find(nKey) == visited.end() || visited[nKey] > neighbor.f)
+        1. Dijkstra from the start and from every goal, one source per worker
+           thread, gives the cheapest leg (cost and path) from each of them to
+           every goal and to the base. Costs depend on the direction of a move,
+           so legs are only ever searched from their first end.
+        2. Held-Karp's bitmask DP over the leg costs finds the cheapest order:
+           best[mask][i] = cheapest way from the start through the goals in mask,
+           ending at goal i. The legs of that order are joined into the path.
+
+        A goal passed on the way to another counts as a later leg of length 0,
+        so splitting the joint optimum at the first visit of each goal shows
+        that no order of legs can be beaten. The DP needs 2^nGoals x nGoals
+        entries, so at most MAX_GOAL_GRAPH_GOALS goals are accepted.
+    */
+    static const int MAX_GOAL_GRAPH_GOALS = 20;
+
+    pair<vector<Coord>, double> findPathGoalGraph(Coord start, int nThreads = 0)
+    {
+        if (nGoals > MAX_GOAL_GRAPH_GOALS)
+            return {{}, 0.0};
+        // Without a base (or start) on the grid there is no leg to index
+        for (const Coord &end : {start, base})
+            if (end.x < 0 || end.y < 0 || end.z < 0 || end.x >= sizeX || end.y >= sizeY || end.z >= sizeZ)
+                return {{}, 0.0};
+
+        // legs[s][t]: source s = start or goal s - 1, target t = goal t or the base (t = nGoals)
+        int nSources = nGoals + 1;
+        vector<vector<int>> legCost(nSources, vector<int>(nGoals + 1, INT_MAX));
+        vector<vector<vector<Coord>>> legs(nSources, vector<vector<Coord>>(nGoals + 1));
+        if (nThreads <= 0)
+            nThreads = max(1u, thread::hardware_concurrency());
+        nThreads = min(nThreads, nSources);
+
+        atomic<int> nextSource{0};
+        auto worker = [&]()
+        {
+            vector<int> dist, parent;
+            for (int s = nextSource++; s < nSources; s = nextSource++)
+            {
+                shortestPaths(s == 0 ? start : rescueGoals[s - 1], dist, parent);
+                for (int t = 0; t <= nGoals; t++)
                 {
-                    pq.push(neighbor);
+                    int target = cellIndex(t == nGoals ? base : rescueGoals[t]);
+                    if (dist[target] == INT_MAX)
+                        continue;
+                    legCost[s][t] = dist[target];
+                    for (int cell = target; cell != -1; cell = parent[cell])
+                        legs[s][t].push_back(cellCoord(cell));
+                    reverse(legs[s][t].begin(), legs[s][t].end());
                 }
             }
+        };
+        vector<thread> threads;
+        for (int i = 1; i < nThreads; i++)
+            threads.emplace_back(worker);
+        worker();
+        for (thread &t : threads)
+            t.join();
+
+        // Order of the goals, then the base
+        vector<int> order;
+        if (nGoals == 0)
+        {
+            if (legCost[0][0] == INT_MAX)
+                return {{}, 0.0};
+            order.push_back(0);
         }
-        return {{}, 0.0};
+        else
+        {
+            const long long INF = LLONG_MAX / 4;
+            int full = (1 << nGoals) - 1;
+            vector<long long> best((size_t)(full + 1) * nGoals, INF);
+            auto at = [&](int mask, int i) -> long long &
+            {
+                return best[(size_t)mask * nGoals + i];
+            };
+            for (int i = 0; i < nGoals; i++)
+                if (legCost[0][i] != INT_MAX)
+                    at(1 << i, i) = legCost[0][i];
+            for (int mask = 1; mask <= full; mask++)
+                for (int i = 0; i < nGoals; i++)
+                {
+                    if (!(mask & (1 << i)) || at(mask, i) == INF)
+                        continue;
+                    for (int j = 0; j < nGoals; j++)
+                        if (!(mask & (1 << j)) && legCost[i + 1][j] != INT_MAX)
+                            at(mask | (1 << j), j) = min(at(mask | (1 << j), j), at(mask, i) + legCost[i + 1][j]);
+                }
+
+            long long total = INF;
+            int last = -1;
+            for (int i = 0; i < nGoals; i++)
+                if (at(full, i) != INF && legCost[i + 1][nGoals] != INT_MAX && at(full, i) + legCost[i + 1][nGoals] < total)
+                {
+                    total = at(full, i) + legCost[i + 1][nGoals];
+                    last = i;
+                }
+            if (last == -1)
+                return {{}, 0.0};
+
+            // Walk the DP back from the last goal
+            order.push_back(nGoals);
+            for (int mask = full, i = last; i != -1;)
+            {
+                order.push_back(i);
+                int previous = mask ^ (1 << i), from = -1;
+                if (previous != 0)
+                    for (int j = 0; j < nGoals && from == -1; j++)
+                        if ((previous & (1 << j)) && at(previous, j) != INF && legCost[j + 1][i] != INT_MAX &&
+                            at(previous, j) + legCost[j + 1][i] == at(mask, i))
+                            from = j;
+                mask = previous;
+                i = from;
+            }
+            reverse(order.begin(), order.end());
+        }
+
+        // Join the legs; each leg starts where the previous one ended
+        vector<Coord> path = {start};
+        double cost = 0;
+        int source = 0;
+        for (int target : order)
+        {
+            cost += legCost[source][target];
+            path.insert(path.end(), legs[source][target].begin() + 1, legs[source][target].end());
+            source = target + 1;
+        }
+        return {path, cost};
     }
 };
 
@@ -194,8 +524,12 @@ int moveCost(const vector<vector<vector<char>>> &grid, const Coord &next, int dz
         return baseCost;
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+    // The joint search is exponential in the goals; past this many the goal graph is used
+    const int JOINT_SEARCH_MAX_GOALS = 10;
+    bool goalGraph = argc > 1 && string(argv[1]) == "--goal-graph";
+
     int layers, n, m;
     cout << "Enter the number of layers:\n";
     cin >> layers;
@@ -238,14 +572,20 @@ int main()
             cout << "\n";
         }
     }
-    if (start.x == -1)
+    if (start.x == -1 || base.x == -1)
     {
         cout << "No path found." << "\n";
         return 0;
     }
     AStarDrone drone(grid, rescueGoals, base);
 
-    auto result = drone.findPath(start);
+    goalGraph = goalGraph || rescueGoals.size() > JOINT_SEARCH_MAX_GOALS;
+    if (goalGraph && rescueGoals.size() > AStarDrone::MAX_GOAL_GRAPH_GOALS)
+    {
+        cout << "Too many rescue goals (at most " << AStarDrone::MAX_GOAL_GRAPH_GOALS << ")." << "\n";
+        return 0;
+    }
+    auto result = goalGraph ? drone.findPathGoalGraph(start) : drone.findPath(start);
     vector<Coord> path = result.first;
     double totalEnergy = result.second;
 
@@ -255,7 +595,7 @@ int main()
     }
     else
     {
-        cout << "Optimal Path Using A*:" << "\n"
+        cout << (goalGraph ? "Optimal Path Using the Goal Graph:" : "Optimal Path Using A*:") << "\n"
              << "\n";
         double energySum = 0.0;
         for (size_t i = 0; i < path.size(); i++)